@@ -0,0 +1,107 @@
+#ifndef RAT_RIDER_COUNT_ALLOCATIONS
+#define RAT_RIDER_COUNT_ALLOCATIONS
+#endif
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include "GameSim.h"
+#include "Counters.h"
+#include "Bot.h"
+
+// Checks that gameplay does not allocate once a round is under way.
+//
+// Bots play single-player and versus rounds in turn, each until it ends or
+// for at most `roundTicks` ticks. The first `warmup` ticks of every round
+// are setup (new bodies, queues reaching their working size) and are not
+// checked; after that any operator new on the simulation thread is a
+// failure, reported against the phase (TraceScope) it happened in. The
+// check counts what GameSim allocates itself; Box2D allocates through
+// b2Alloc and is not seen (see AllocationTracker).
+//
+// Usage: AllocationCheck [ticks] [warmup] [roundTicks]
+
+namespace {
+
+const float FRAME_DT = 1.f / 60.f;
+const float WINDOW_WIDTH = 1200.f;
+const float WINDOW_HEIGHT = 700.f;
+
+}
+
+int main(int argc, char** argv) {
+    int ticks = argc > 1 ? std::atoi(argv[1]) : 36000;
+    int warmup = argc > 2 ? std::atoi(argv[2]) : 120;
+    int roundTicks = argc > 3 ? std::atoi(argv[3]) : 3600;
+
+    Tunables tun = loadTunables("tunables.cfg");
+    BotWorld botWorld = makeBotWorld(tun, PIXELS_PER_METER, WINDOW_HEIGHT);
+    GameSim sim(tun, WINDOW_WIDTH, WINDOW_HEIGHT);
+    std::vector<JumpBot> bots(MAX_PLAYERS, JumpBot(200));
+    BotObservation observation;
+    PlayerInput inputs[MAX_PLAYERS];
+
+    uint32_t seed = 1;
+    GameMode mode = SinglePlayerMode;
+    sim.startRound(mode, seed);
+    int roundTick = 0;
+    int rounds = 1;
+    int checkedTicks = 0;
+    int allocatingTicks = 0;
+    AllocationStats steadyTotal;
+    std::vector<AllocationStats> before(AllocationTracker::MAX_PHASES), steadyByPhase(AllocationTracker::MAX_PHASES);
+
+    for (int tick = 0; tick < ticks; tick++) {
+        bool checked = roundTick >= warmup;
+        int phasesBefore = AllocationTracker::phaseCount();
+        for (int i = 0; i < phasesBefore; i++) before[i] = AllocationTracker::phase(i);
+        AllocationStats start = AllocationTracker::thread();
+
+        {
+            TraceScope traceBots("bots");
+            for (int p = 0; p < sim.playerCount; p++) {
+                inputs[p] = PlayerInput();
+                if (!sim.players[p].body) continue;
+                sim.observe(p, observation);
+                inputs[p] = bots[p].think(observation, botWorld);
+            }
+        }
+        sim.tick(FRAME_DT, inputs);
+
+        AllocationStats end = AllocationTracker::thread();
+        if (checked) {
+            checkedTicks++;
+            if (end.count != start.count) {
+                allocatingTicks++;
+                steadyTotal.count += end.count - start.count;
+                steadyTotal.bytes += end.bytes - start.bytes;
+                // Other threads allocate too (the course generator), so this
+                // attribution can include a little of theirs.
+                for (int i = 0; i < AllocationTracker::phaseCount(); i++) {
+                    AllocationStats now = AllocationTracker::phase(i);
+                    AllocationStats then = i < phasesBefore ? before[i] : AllocationStats();
+                    steadyByPhase[i].count += now.count - then.count;
+                    steadyByPhase[i].bytes += now.bytes - then.bytes;
+                }
+            }
+        }
+
+        roundTick++;
+        if (sim.roundOver || roundTick >= roundTicks) {
+            seed++;
+            mode = (mode == SinglePlayerMode) ? VersusMode : SinglePlayerMode;
+            sim.startRound(mode, seed);
+            roundTick = 0;
+            rounds++;
+        }
+    }
+
+    std::cout << ticks << " ticks in " << rounds << " rounds, " << checkedTicks << " checked after a " << warmup << "-tick warm-up\n";
+    std::cout << allocatingTicks << " ticks allocated, " << steadyTotal.count << " allocations (" << steadyTotal.bytes << " bytes)\n";
+    for (int i = 0; i < AllocationTracker::phaseCount(); i++) {
+        if (steadyByPhase[i].count == 0) continue;
+        std::cout << "  " << AllocationTracker::phaseName(i) << ": " << steadyByPhase[i].count
+                  << " (" << steadyByPhase[i].bytes << " bytes)\n";
+    }
+    std::cout << std::flush;
+    return allocatingTicks == 0 ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstddef>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define RAT_RIDER_POSIX_IO 1
+#endif
+
+
+// Writes "<path>.tmp", syncs it and renames it over path, so a crash
+// mid-write leaves the previous file intact. Returns false on any failure;
+// the caller reports it.
+inline bool writeFileAtomically(const std::string& path, const char* data, size_t size) {
+    std::string tempPath = path + ".tmp";
+#ifdef RAT_RIDER_POSIX_IO
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(fd, data + written, size - written);
+        if (n <= 0) break;
+        written += static_cast<size_t>(n);
+    }
+    bool ok = (written == size) && fsync(fd) == 0;
+    close(fd);
+    if (!ok || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+#else
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(data, size)) return false;
+    }
+    std::remove(path.c_str());
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+#endif
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include "Tunables.h"
+#include "CourseGenerator.h"
+#include "Bot.h"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// Lockstep simulator for many single-player games at once, without Box2D.
+//
+// It models only what the game's physics actually does for the player:
+// - axis-aligned platforms moving left at the speed they spawned with
+// - one box player at a fixed start x
+// - gravity (scaled while fast-falling in the air)
+// - jump impulses, with GameSim's jump buffer and coyote lapse
+// - the ceiling, the ground and the Box2D speed clamp
+// Collectibles and platform effects are not simulated. Platforms come from
+// the same CourseGenerator, with the same seed, as GameSim, so a BatchSim
+// lane and a GameSim round with collectibleSpawnChance = 0 play the same
+// course.
+//
+// State is structure-of-arrays, padded to a multiple of four games. The
+// player kernel steps four games per iteration with SSE2, with a scalar
+// loop on other architectures. Platform spawning is rare and stays scalar.
+class BatchSim {
+public:
+    static constexpr int PLATFORM_SLOTS = 8;
+    static constexpr float CONTACT_TOLERANCE = 1.f;     // px, covers Box2D's polygon skin
+    static constexpr float MAX_TRANSLATION = 2.f;       // m per step, b2_maxTranslation
+
+    BatchSim(const Tunables& tunables, size_t gameCount, float windowWidth, float windowHeight,
+             float pixelsPerMeter = 50.f)
+        : tun(tunables), count(gameCount), stride((gameCount + 3) & ~size_t(3)),
+          windowWidth(windowWidth), windowHeight(windowHeight), pixelsPerMeter(pixelsPerMeter),
+          world(makeBotWorld(tunables, pixelsPerMeter, windowHeight)) {
+        for (std::vector<float>* lane : { &x, &y, &vx, &vy, &jumps, &jumpBuffer, &coyoteLeft, &grounded, &alive,
+                                          &blockSpeed, &gameTime, &spawnTime, &nextSpawnTime }) {
+            lane->assign(stride, 0.f);
+        }
+        for (std::vector<float>* slot : { &platformLeft, &platformRight, &platformTop, &platformSpeed }) {
+            slot->assign(stride * PLATFORM_SLOTS, 0.f);
+        }
+        actionBytes.assign(stride, 0);
+        for (size_t g = 0; g < count; g++) {
+            courses.emplace_back(new CourseGenerator(false));
+            upcoming.emplace_back();
+        }
+    }
+
+    size_t size() const { return count; }
+
+    // Starts game g the way GameSim::startRound does for single player.
+    void reset(size_t g, uint32_t seed) {
+        x[g] = windowWidth / 4.f;
+        y[g] = windowHeight - 600.f;
+        vx[g] = 0.f;
+        vy[g] = 0.f;
+        jumps[g] = static_cast<float>(tun.maxJumps);
+        jumpBuffer[g] = 0.f;
+        coyoteLeft[g] = -1.f;
+        grounded[g] = 0.f;
+        alive[g] = 1.f;
+        blockSpeed[g] = tun.startBlockSpeed;
+        gameTime[g] = 0.f;
+        for (int s = 0; s < PLATFORM_SLOTS; s++) clearSlot(s, g);
+
+        float initialLength = windowWidth - 250.f;
+        placePlatform(0, g, windowWidth / 2.f, windowHeight - 500.f, initialLength);
+
+        CourseParams params;
+        params.tun = tun;
+        params.windowWidth = windowWidth;
+        params.windowHeight = windowHeight;
+        params.pixelsPerMeter = pixelsPerMeter;
+        params.playerX = windowWidth / 4.f;
+        params.hasPreviousPlatform = true;
+        params.previousRightEdge = windowWidth / 2.f + initialLength / 2.f;
+        params.previousY = windowHeight - 500.f;
+        courses[g]->restart(params, seed, 0.f);
+        upcoming[g] = courses[g]->next();
+        nextSpawnTime[g] = upcoming[g].delay;
+        spawnTime[g] = 0.f;
+    }
+
+    void resetAll(uint32_t seed) {
+        for (size_t g = 0; g < count; g++) reset(g, seed + static_cast<uint32_t>(g));
+    }
+
+    // Advances every live game by dt. actions holds one packInput() byte per game.
+    void step(float dt, const uint8_t* actions) {
+        std::memcpy(actionBytes.data(), actions, count);
+
+        // Platforms: a plain streaming update, vectorised by the compiler.
+        for (size_t i = 0; i < platformLeft.size(); i++) {
+            float shift = platformSpeed[i] * dt;
+            platformLeft[i] -= shift;
+            platformRight[i] -= shift;
+        }
+
+        size_t g = 0;
+#ifdef __SSE2__
+        for (; g + 4 <= stride; g += 4) stepPlayersSse2(g, dt);
+#endif
+        for (; g < count; g++) stepPlayerScalar(g, dt);
+
+        for (g = 0; g < count; g++) {
+            if (alive[g] == 0.f) continue;
+            gameTime[g] += dt;
+            spawnTime[g] += dt;
+            if (spawnTime[g] >= nextSpawnTime[g]) spawnFromCourse(g);
+            blockSpeed[g] = std::min(blockSpeed[g] + tun.blockSpeedIncreaseFactor * dt, tun.maxBlockSpeed);
+        }
+    }
+
+    const Tunables tun;
+    const size_t count;
+    const size_t stride;
+    const float windowWidth, windowHeight, pixelsPerMeter;
+    const BotWorld world;
+
+    // Per game, indexed [g]. alive, grounded are 0 or 1. jumpBuffer and
+    // coyoteLeft mean what they do on SimPlayer.
+    std::vector<float> x, y, vx, vy, jumps, jumpBuffer, coyoteLeft, grounded, alive;
+    std::vector<float> blockSpeed, gameTime, spawnTime, nextSpawnTime;
+    // Per platform slot and game, indexed [slot * stride + g]. Free slots sit far off to the right.
+    std::vector<float> platformLeft, platformRight, platformTop, platformSpeed;
+    size_t droppedSpawns = 0;       // spawns lost because every slot was in use
+
+private:
+    static constexpr float FREE_SLOT_X = 1e9f;
+
+    void clearSlot(int s, size_t g) {
+        size_t i = s * stride + g;
+        platformLeft[i] = FREE_SLOT_X;
+        platformRight[i] = FREE_SLOT_X;
+        platformTop[i] = 0.f;
+        platformSpeed[i] = 0.f;
+    }
+
+    void placePlatform(int s, size_t g, float centerX, float centerY, float length) {
+        size_t i = s * stride + g;
+        platformLeft[i] = centerX - length / 2.f;
+        platformRight[i] = centerX + length / 2.f;
+        platformTop[i] = centerY - tun.fixedHeight / 2.f;
+        platformSpeed[i] = blockSpeed[g];
+    }
+
+    // Same placement as GameSim::spawnFromCourse; the course generator has
+    // already kept the spec clear of the platform before it.
+    void spawnFromCourse(size_t g) {
+        const PlatformSpec& spec = upcoming[g];
+        float length = tun.baseMinLength + spec.lengthT * (tun.baseMaxLength - tun.baseMinLength);
+        float centerX = windowWidth + length / 2.f;
+
+        int freeSlot = -1;
+        for (int s = 0; s < PLATFORM_SLOTS && freeSlot < 0; s++) {
+            size_t i = s * stride + g;
+            if (platformRight[i] < 0.f || platformLeft[i] == FREE_SLOT_X) freeSlot = s;
+        }
+        if (freeSlot >= 0) placePlatform(freeSlot, g, centerX, spec.spawnY, length);
+        else droppedSpawns++;
+
+        spawnTime[g] = 0.f;
+        upcoming[g] = courses[g]->next();
+        nextSpawnTime[g] = upcoming[g].delay;
+    }
+
+    void stepPlayerScalar(size_t g, float dt) {
+        if (alive[g] == 0.f) return;
+        const float hw = world.halfWidth, hh = world.halfHeight;
+        const float maxSpeed = MAX_TRANSLATION * pixelsPerMeter / dt;
+        uint8_t action = actionBytes[g];
+
+        float px = x[g], py = y[g], pvx = vx[g], pvy = vy[g];
+        float pjumps = jumps[g], pbuffer = jumpBuffer[g], pcoyote = coyoteLeft[g];
+        bool pressed = (action & InputJump) != 0;
+        if ((pressed || pbuffer > 0.f) && pjumps > 0.f) {
+            pvy -= world.jumpSpeed;
+            pjumps -= 1.f;
+            pbuffer = 0.f;
+        } else if (pressed) {
+            pbuffer = world.jumpBufferTime;
+        } else {
+            pbuffer = std::max(0.f, pbuffer - dt);
+        }
+        bool fastFalling = (action & InputFastFall) && grounded[g] == 0.f;
+        pvy += world.gravity * (fastFalling ? world.fastFallScale : 1.f) * dt;
+        pvy = std::max(-maxSpeed, std::min(pvy, maxSpeed));
+
+        float previousTop = py - hh, previousBottom = py + hh, previousRight = px + hw;
+        px += pvx * dt;
+        py += pvy * dt;
+        if (py - hh < world.ceilingY) {
+            py = world.ceilingY + hh;
+            pvy = std::max(pvy, 0.f);
+        }
+
+        float landed = 0.f;
+        for (int s = 0; s < PLATFORM_SLOTS; s++) {
+            size_t i = s * stride + g;
+            float left = platformLeft[i], right = platformRight[i];
+            float top = platformTop[i], bottom = top + tun.fixedHeight;
+            if (px + hw <= left || px - hw >= right) continue;
+            if (pvy >= 0.f && previousBottom <= top + CONTACT_TOLERANCE && py + hh >= top) {
+                py = top - hh;
+                pvy = 0.f;
+                landed = 1.f;
+            } else if (pvy < 0.f && previousTop >= bottom - CONTACT_TOLERANCE && py - hh < bottom) {
+                py = bottom + hh;
+                pvy = 0.f;
+            } else if (py + hh > top + CONTACT_TOLERANCE && py - hh < bottom - CONTACT_TOLERANCE &&
+                       previousRight <= left + platformSpeed[i] * dt + CONTACT_TOLERANCE) {
+                // Pushed by the platform's leading edge; friction is off, so the push sticks.
+                px = left - hw;
+                pvx = -platformSpeed[i];
+            }
+        }
+        const float maxJumps = static_cast<float>(world.maxJumps);
+        if (landed != 0.f) {
+            pjumps = maxJumps;
+            pcoyote = world.coyoteTime;
+        } else if (world.coyoteTime >= 0.f && pcoyote >= 0.f && pjumps == maxJumps && pjumps > 0.f) {
+            pcoyote -= dt;
+            if (pcoyote <= 0.f) {
+                pcoyote = 0.f;
+                pjumps -= 1.f;
+            }
+        }
+
+        bool dead = py > world.deathY || py + hh >= world.groundY || px < -2.f * hw;
+        x[g] = px;
+        y[g] = py;
+        vx[g] = pvx;
+        vy[g] = pvy;
+        jumps[g] = pjumps;
+        jumpBuffer[g] = pbuffer;
+        coyoteLeft[g] = pcoyote;
+        grounded[g] = landed;
+        alive[g] = dead ? 0.f : 1.f;
+    }
+
+#ifdef __SSE2__
+    static __m128 select(__m128 mask, __m128 a, __m128 b) {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // stepPlayerScalar for games g..g+3. Dead games (and padding) keep their state.
+    void stepPlayersSse2(size_t g, float dt) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 hw = _mm_set1_ps(world.halfWidth);
+        const __m128 hh = _mm_set1_ps(world.halfHeight);
+        const __m128 vdt = _mm_set1_ps(dt);
+        const __m128 tolerance = _mm_set1_ps(CONTACT_TOLERANCE);
+        const __m128 thickness = _mm_set1_ps(tun.fixedHeight);
+        const __m128 maxSpeed = _mm_set1_ps(MAX_TRANSLATION * pixelsPerMeter / dt);
+
+        __m128 live = _mm_cmpneq_ps(_mm_loadu_ps(&alive[g]), zero);
+        if (_mm_movemask_ps(live) == 0) return;
+
+        int32_t packed;
+        std::memcpy(&packed, &actionBytes[g], sizeof(packed));
+        const __m128i zeroi = _mm_setzero_si128();
+        __m128i bits = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zeroi), zeroi);
+        __m128i jumpBit = _mm_set1_epi32(InputJump);
+        __m128i fastFallBit = _mm_set1_epi32(InputFastFall);
+        __m128 jumpHeld = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(bits, jumpBit), jumpBit));
+        __m128 fastFallHeld = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(bits, fastFallBit), fastFallBit));
+
+        __m128 px = _mm_loadu_ps(&x[g]);
+        __m128 py = _mm_loadu_ps(&y[g]);
+        __m128 pvx = _mm_loadu_ps(&vx[g]);
+        __m128 pvy = _mm_loadu_ps(&vy[g]);
+        __m128 pjumps = _mm_loadu_ps(&jumps[g]);
+        __m128 pbuffer = _mm_loadu_ps(&jumpBuffer[g]);
+        __m128 pcoyote = _mm_loadu_ps(&coyoteLeft[g]);
+        __m128 wasGrounded = _mm_cmpneq_ps(_mm_loadu_ps(&grounded[g]), zero);
+
+        __m128 wantsJump = _mm_or_ps(jumpHeld, _mm_cmpgt_ps(pbuffer, zero));
+        __m128 jumping = _mm_and_ps(wantsJump, _mm_cmpgt_ps(pjumps, zero));
+        pvy = _mm_sub_ps(pvy, _mm_and_ps(jumping, _mm_set1_ps(world.jumpSpeed)));
+        pjumps = _mm_sub_ps(pjumps, _mm_and_ps(jumping, one));
+        pbuffer = select(jumping, zero,
+                  select(jumpHeld, _mm_set1_ps(world.jumpBufferTime), _mm_max_ps(zero, _mm_sub_ps(pbuffer, vdt))));
+        __m128 fastFalling = _mm_andnot_ps(wasGrounded, fastFallHeld);
+        __m128 gravityScale = select(fastFalling, _mm_set1_ps(world.fastFallScale), one);
+        pvy = _mm_add_ps(pvy, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(world.gravity), gravityScale), vdt));
+        pvy = _mm_max_ps(_mm_sub_ps(zero, maxSpeed), _mm_min_ps(pvy, maxSpeed));
+
+        __m128 previousTop = _mm_sub_ps(py, hh);
+        __m128 previousBottom = _mm_add_ps(py, hh);
+        __m128 previousRight = _mm_add_ps(px, hw);
+        px = _mm_add_ps(px, _mm_mul_ps(pvx, vdt));
+        py = _mm_add_ps(py, _mm_mul_ps(pvy, vdt));
+        __m128 ceilingY = _mm_set1_ps(world.ceilingY);
+        __m128 hitCeiling = _mm_cmplt_ps(_mm_sub_ps(py, hh), ceilingY);
+        py = select(hitCeiling, _mm_add_ps(ceilingY, hh), py);
+        pvy = select(hitCeiling, _mm_max_ps(pvy, zero), pvy);
+
+        __m128 landed = zero;
+        for (int s = 0; s < PLATFORM_SLOTS; s++) {
+            size_t i = s * stride + g;
+            __m128 left = _mm_loadu_ps(&platformLeft[i]);
+            __m128 right = _mm_loadu_ps(&platformRight[i]);
+            __m128 top = _mm_loadu_ps(&platformTop[i]);
+            __m128 speed = _mm_loadu_ps(&platformSpeed[i]);
+            __m128 bottom = _mm_add_ps(top, thickness);
+            __m128 overlapX = _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(px, hw), left), _mm_cmplt_ps(_mm_sub_ps(px, hw), right));
+            if (_mm_movemask_ps(overlapX) == 0) continue;
+
+            __m128 land = _mm_and_ps(overlapX, _mm_and_ps(_mm_cmpge_ps(pvy, zero),
+                          _mm_and_ps(_mm_cmple_ps(previousBottom, _mm_add_ps(top, tolerance)),
+                                     _mm_cmpge_ps(_mm_add_ps(py, hh), top))));
+            __m128 bump = _mm_andnot_ps(land, _mm_and_ps(overlapX, _mm_and_ps(_mm_cmplt_ps(pvy, zero),
+                          _mm_and_ps(_mm_cmpge_ps(previousTop, _mm_sub_ps(bottom, tolerance)),
+                                     _mm_cmplt_ps(_mm_sub_ps(py, hh), bottom)))));
+            __m128 side = _mm_andnot_ps(_mm_or_ps(land, bump), _mm_and_ps(overlapX,
+                          _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(py, hh), _mm_add_ps(top, tolerance)),
+                                                _mm_cmplt_ps(_mm_sub_ps(py, hh), _mm_sub_ps(bottom, tolerance))),
+                                     _mm_cmple_ps(previousRight, _mm_add_ps(left, _mm_add_ps(_mm_mul_ps(speed, vdt), tolerance))))));
+
+            py = select(land, _mm_sub_ps(top, hh), py);
+            py = select(bump, _mm_add_ps(bottom, hh), py);
+            pvy = select(_mm_or_ps(land, bump), zero, pvy);
+            px = select(side, _mm_sub_ps(left, hw), px);
+            pvx = select(side, _mm_sub_ps(zero, speed), pvx);
+            landed = _mm_or_ps(landed, land);
+        }
+        const __m128 maxJumps = _mm_set1_ps(static_cast<float>(world.maxJumps));
+        pjumps = select(landed, maxJumps, pjumps);
+        pcoyote = select(landed, _mm_set1_ps(world.coyoteTime), pcoyote);
+        if (world.coyoteTime >= 0.f) {
+            __m128 counting = _mm_andnot_ps(landed, _mm_and_ps(_mm_cmpge_ps(pcoyote, zero),
+                              _mm_and_ps(_mm_cmpeq_ps(pjumps, maxJumps), _mm_cmpgt_ps(pjumps, zero))));
+            pcoyote = select(counting, _mm_sub_ps(pcoyote, vdt), pcoyote);
+            __m128 lapsed = _mm_and_ps(counting, _mm_cmple_ps(pcoyote, zero));
+            pcoyote = select(lapsed, zero, pcoyote);
+            pjumps = _mm_sub_ps(pjumps, _mm_and_ps(lapsed, one));
+        }
+
+        __m128 dead = _mm_or_ps(_mm_cmpgt_ps(py, _mm_set1_ps(world.deathY)),
+                      _mm_or_ps(_mm_cmpge_ps(_mm_add_ps(py, hh), _mm_set1_ps(world.groundY)),
+                                _mm_cmplt_ps(px, _mm_mul_ps(_mm_set1_ps(-2.f), hw))));
+
+        _mm_storeu_ps(&x[g], select(live, px, _mm_loadu_ps(&x[g])));
+        _mm_storeu_ps(&y[g], select(live, py, _mm_loadu_ps(&y[g])));
+        _mm_storeu_ps(&vx[g], select(live, pvx, _mm_loadu_ps(&vx[g])));
+        _mm_storeu_ps(&vy[g], select(live, pvy, _mm_loadu_ps(&vy[g])));
+        _mm_storeu_ps(&jumps[g], select(live, pjumps, _mm_loadu_ps(&jumps[g])));
+        _mm_storeu_ps(&jumpBuffer[g], select(live, pbuffer, _mm_loadu_ps(&jumpBuffer[g])));
+        _mm_storeu_ps(&coyoteLeft[g], select(live, pcoyote, _mm_loadu_ps(&coyoteLeft[g])));
+        _mm_storeu_ps(&grounded[g], select(live, _mm_and_ps(landed, one), _mm_loadu_ps(&grounded[g])));
+        _mm_storeu_ps(&alive[g], select(live, _mm_andnot_ps(dead, one), zero));
+    }
+#endif
+
+    std::vector<std::unique_ptr<CourseGenerator>> courses;
+    std::vector<PlatformSpec> upcoming;
+    std::vector<uint8_t> actionBytes;
+};
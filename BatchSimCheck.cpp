@@ -0,0 +1,132 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "GameSim.h"
+#include "BatchSim.h"
+
+// Checks BatchSim against the Box2D game and measures both.
+//
+// Validation: for each seed, a GameSim round (collectibles off) and a
+// BatchSim lane play the same course with the same scripted input. The
+// player's y is compared every tick until either one dies.
+//
+// Throughput: game-ticks per second for one GameSim against a BatchSim
+// of `games` lanes.
+//
+// Usage: BatchSimCheck [games] [ticks] [seeds]
+
+namespace {
+
+const float FRAME_DT = 1.f / 60.f;
+const float WINDOW_WIDTH = 1200.f;
+const float WINDOW_HEIGHT = 700.f;
+
+// Deterministic input script: mostly idle, occasional jumps and fast-falls.
+uint8_t scriptedInput(uint32_t seed, int tick) {
+    uint32_t h = (seed * 0x9E3779B9u) ^ (static_cast<uint32_t>(tick) * 0x85EBCA6Bu);
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    uint8_t bits = 0;
+    if (h % 40 == 0) bits |= InputJump;
+    if ((h >> 8) % 9 == 0) bits |= InputFastFall;
+    return bits;
+}
+
+struct Divergence {
+    int ticksCompared = 0;
+    float maxError = 0.f;
+    int firstBadTick = -1;
+    int box2dDeathTick = -1;
+    int batchDeathTick = -1;
+};
+
+Divergence compareRun(const Tunables& tun, uint32_t seed, int maxTicks, float tolerance) {
+    GameSim reference(tun, WINDOW_WIDTH, WINDOW_HEIGHT, false);
+    reference.startRound(SinglePlayerMode, seed);
+    BatchSim batch(tun, 1, WINDOW_WIDTH, WINDOW_HEIGHT, PIXELS_PER_METER);
+    batch.reset(0, seed);
+
+    Divergence result;
+    PlayerInput inputs[MAX_PLAYERS];
+    for (int tick = 0; tick < maxTicks; tick++) {
+        uint8_t action = scriptedInput(seed, tick);
+        inputs[0] = unpackInput(action);
+        reference.tick(FRAME_DT, inputs);
+        batch.step(FRAME_DT, &action);
+
+        bool referenceAlive = !reference.roundOver;
+        bool batchAlive = batch.alive[0] != 0.f;
+        if (!referenceAlive && result.box2dDeathTick < 0) result.box2dDeathTick = tick;
+        if (!batchAlive && result.batchDeathTick < 0) result.batchDeathTick = tick;
+        if (!referenceAlive || !batchAlive) break;
+
+        float error = std::fabs(reference.players[0].y - batch.y[0]);
+        result.maxError = std::max(result.maxError, error);
+        if (error > tolerance && result.firstBadTick < 0) result.firstBadTick = tick;
+        result.ticksCompared++;
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t games = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+    int ticks = argc > 2 ? std::atoi(argv[2]) : 3600;
+    int seeds = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    Tunables tun = loadTunables("tunables.cfg");
+    tun.collectibleSpawnChance = 0.f;
+
+    const float tolerance = 3.f;
+    int agreeing = 0;
+    for (int s = 0; s < seeds; s++) {
+        uint32_t seed = 1000u + static_cast<uint32_t>(s);
+        Divergence d = compareRun(tun, seed, ticks, tolerance);
+        bool sameDeath = d.box2dDeathTick == d.batchDeathTick ||
+                         (d.box2dDeathTick >= 0 && d.batchDeathTick >= 0 && std::abs(d.box2dDeathTick - d.batchDeathTick) <= 2);
+        bool ok = d.firstBadTick < 0 && sameDeath;
+        if (ok) agreeing++;
+        std::cout << "seed " << seed << ": " << d.ticksCompared << " ticks, max |dy| " << d.maxError << " px"
+                  << ", deaths box2d " << d.box2dDeathTick << " batch " << d.batchDeathTick
+                  << (d.firstBadTick >= 0 ? ", diverged at tick " + std::to_string(d.firstBadTick) : std::string())
+                  << (ok ? "" : "  MISMATCH") << "\n";
+    }
+    std::cout << agreeing << "/" << seeds << " runs within " << tolerance << " px\n";
+
+    // Box2D: one game at a time, restarted whenever it ends.
+    GameSim reference(tun, WINDOW_WIDTH, WINDOW_HEIGHT, false);
+    reference.startRound(SinglePlayerMode, 1);
+    PlayerInput inputs[MAX_PLAYERS];
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; tick++) {
+        inputs[0] = unpackInput(scriptedInput(1, tick));
+        reference.tick(FRAME_DT, inputs);
+        if (reference.roundOver) reference.startRound(SinglePlayerMode, static_cast<uint32_t>(tick));
+    }
+    double box2dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double box2dRate = ticks / box2dSeconds;
+
+    BatchSim batch(tun, games, WINDOW_WIDTH, WINDOW_HEIGHT, PIXELS_PER_METER);
+    batch.resetAll(1);
+    std::vector<uint8_t> actions(games);
+    start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; tick++) {
+        for (size_t g = 0; g < games; g++) actions[g] = scriptedInput(static_cast<uint32_t>(g), tick);
+        batch.step(FRAME_DT, actions.data());
+        for (size_t g = 0; g < games; g++) {
+            if (batch.alive[g] == 0.f) batch.reset(g, static_cast<uint32_t>(g * 7919 + tick));
+        }
+    }
+    double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double batchRate = static_cast<double>(ticks) * games / batchSeconds;
+
+    std::cout << "box2d: " << static_cast<long long>(box2dRate) << " game-ticks/s\n";
+    std::cout << "batch: " << static_cast<long long>(batchRate) << " game-ticks/s (" << games << " games, "
+              << batchRate / box2dRate << "x, " << batch.droppedSpawns << " dropped spawns)" << std::endl;
+    return agreeing == seeds ? 0 : 1;
+}
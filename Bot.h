@@ -0,0 +1,272 @@
+#pragma once
+
+#include "Tunables.h"
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+// What one player asks for this frame. Keyboard handling and bots both
+// fill one of these; the game applies them the same way.
+struct PlayerInput {
+    bool jumpPressed = false;   // edge: a jump was requested this frame
+    bool fastFall = false;      // level: fast-fall is held
+};
+
+// PlayerInput packed into one byte, for batched and recorded input.
+enum InputBits : uint8_t { InputJump = 1, InputFastFall = 2 };
+
+inline uint8_t packInput(const PlayerInput& input) {
+    return static_cast<uint8_t>((input.jumpPressed ? InputJump : 0) | (input.fastFall ? InputFastFall : 0));
+}
+
+inline PlayerInput unpackInput(uint8_t bits) {
+    PlayerInput input;
+    input.jumpPressed = (bits & InputJump) != 0;
+    input.fastFall = (bits & InputFastFall) != 0;
+    return input;
+}
+
+
+struct BotPlatform {
+    float left, right;          // pixels, at observation time
+    float top;                  // y of the top surface
+};
+
+// Collectibles are kinematic: each keeps the velocity it was spawned with,
+// riding its platform or, for magenta rain, falling straight down.
+struct BotCollectible {
+    float x, y;
+    float vx, vy;
+    float value;                // how much the bot wants it (negative = avoid)
+};
+
+// Snapshot of everything the bot plans against, in pixels and pixels/second.
+// The vectors are reused frame to frame by the caller.
+struct BotObservation {
+    float playerX = 0.f, playerY = 0.f;     // body centre
+    float playerVY = 0.f;
+    bool grounded = false;
+    int jumpsRemaining = 0;
+    float jumpBuffer = 0.f;         // seconds a queued press has left
+    float coyoteLeft = -1.f;        // seconds before the ground jump lapses; negative until first landed
+    float blockSpeed = 0.f;
+    std::vector<BotPlatform> platforms;
+    std::vector<BotCollectible> collectibles;
+};
+
+// World constants the forward model needs, in pixels.
+struct BotWorld {
+    float gravity = 350.f;          // px/s^2
+    float jumpSpeed = 500.f;        // px/s
+    float fastFallScale = 100.f;
+    int maxJumps = 2;
+    float coyoteTime = -1.f;        // s, negative keeps the ground jump for the whole fall
+    float jumpBufferTime = 0.f;     // s
+    float halfWidth = 30.f;
+    float halfHeight = 40.f;
+    float ceilingY = 0.f;           // bottom of the ceiling
+    float deathY = 780.f;           // player centre below this is dead
+    float groundY = 740.f;          // top of the ground body
+};
+
+inline BotWorld makeBotWorld(const Tunables& tun, float pixelsPerMeter, float windowHeight) {
+    BotWorld world;
+    world.gravity = tun.gravity * pixelsPerMeter;
+    world.jumpSpeed = tun.playerJumpForce;
+    world.fastFallScale = tun.fastFallGravityScale;
+    world.maxJumps = tun.maxJumps;
+    world.coyoteTime = tun.coyoteTime;
+    world.jumpBufferTime = tun.jumpBufferTime;
+    world.halfWidth = tun.playerWidth / 2.f;
+    world.halfHeight = tun.playerHeight / 2.f;
+    world.ceilingY = 0.f;
+    world.deathY = windowHeight + tun.playerHeight;
+    world.groundY = windowHeight + 40.f;
+    return world;
+}
+
+
+// Receding-horizon planner. Every frame it simulates a fixed family of
+// plans (when to jump, when to double jump, when to start fast-falling)
+// against a simple kinematic model of the player and the platforms ahead,
+// picks the best-scoring plan and executes only its first frame. Planning
+// stops early when the time budget runs out, keeping the best plan so far.
+class JumpBot {
+public:
+    static constexpr int HORIZON_TICKS = 96;
+    static constexpr float TICK = 1.f / 60.f;
+    static constexpr int JUMP_COOLDOWN_TICKS = 6;
+
+    explicit JumpBot(int budgetMicros = 500) : budgetMicros(budgetMicros) {}
+
+    PlayerInput think(const BotObservation& obs, const BotWorld& world) {
+        auto start = std::chrono::steady_clock::now();
+        static const int jumpTicks[] = { NEVER, 0, 4, 8, 12, 18, 24, 32, 44, 60 };
+        static const int secondJumpDelays[] = { NEVER, 8, 16, 26, 40 };
+        static const int fastFallTicks[] = { NEVER, 0, 10, 20, 32, 48 };
+
+        Plan best;
+        float bestScore = -1e30f;
+        plansEvaluated = 0;
+        bool outOfTime = false;
+        for (int fastFall : fastFallTicks) {
+            for (int jump : jumpTicks) {
+                for (int secondDelay : secondJumpDelays) {
+                    if (jump == NEVER && secondDelay != NEVER) continue;
+                    Plan plan;
+                    plan.jumpTick = jump;
+                    plan.secondJumpTick = (secondDelay == NEVER) ? NEVER : jump + secondDelay;
+                    plan.fastFallTick = fastFall;
+                    float score = simulate(obs, world, plan);
+                    plansEvaluated++;
+                    // Prefer doing nothing on ties so the bot does not twitch.
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = plan;
+                    }
+                }
+                if (elapsedMicros(start) > budgetMicros) {
+                    outOfTime = true;
+                    break;
+                }
+            }
+            if (outOfTime) break;
+        }
+
+        PlayerInput input;
+        // A press with no jumps left is not wasted: the game buffers it, and
+        // the model has already scored what that buffered jump does.
+        input.jumpPressed = best.jumpTick == 0 && cooldown == 0;
+        input.fastFall = best.fastFallTick == 0 && !obs.grounded;
+        if (input.jumpPressed) cooldown = JUMP_COOLDOWN_TICKS;
+        else if (cooldown > 0) cooldown--;
+        lastThinkMicros = elapsedMicros(start);
+        return input;
+    }
+
+    int budgetMicros;
+    int plansEvaluated = 0;
+    long long lastThinkMicros = 0;
+
+private:
+    static constexpr int NEVER = -1000;
+
+    struct Plan {
+        int jumpTick = NEVER;
+        int secondJumpTick = NEVER;
+        int fastFallTick = NEVER;
+    };
+
+    static long long elapsedMicros(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    float simulate(const BotObservation& obs, const BotWorld& world, const Plan& plan) const {
+        float y = obs.playerY;
+        float vy = obs.playerVY;
+        bool grounded = obs.grounded;
+        int jumps = obs.jumpsRemaining;
+        float buffer = obs.jumpBuffer;
+        float coyote = obs.coyoteLeft;
+        int sinceJump = JUMP_COOLDOWN_TICKS - cooldown;
+        float collected = 0.f;
+        int sideHits = 0;
+        int jumpsUsed = 0;
+        uint32_t takenMask = 0;
+
+        for (int tick = 0; tick < HORIZON_TICKS; tick++) {
+            float shift = obs.blockSpeed * TICK * tick;
+            // Same jump rules as GameSim::tick: a press with no jumps left
+            // stays queued for jumpBufferTime.
+            bool pressed = (tick == plan.jumpTick || tick == plan.secondJumpTick) && sinceJump >= JUMP_COOLDOWN_TICKS;
+            if ((pressed || buffer > 0.f) && jumps > 0) {
+                vy -= world.jumpSpeed;
+                jumps--;
+                jumpsUsed++;
+                grounded = false;
+                buffer = 0.f;
+            } else if (pressed) {
+                buffer = world.jumpBufferTime;
+            } else {
+                buffer = std::max(0.f, buffer - TICK);
+            }
+            sinceJump = pressed ? 0 : sinceJump + 1;
+
+            if (grounded && !supported(obs, world, y, shift)) grounded = false;
+            if (!grounded) {
+                bool fastFalling = plan.fastFallTick != NEVER && tick >= plan.fastFallTick;
+                float previousBottom = y + world.halfHeight;
+                vy += world.gravity * (fastFalling ? world.fastFallScale : 1.f) * TICK;
+                y += vy * TICK;
+                if (y - world.halfHeight < world.ceilingY) {
+                    y = world.ceilingY + world.halfHeight;
+                    vy = std::max(vy, 0.f);
+                }
+                float bottom = y + world.halfHeight;
+                for (const BotPlatform& platform : obs.platforms) {
+                    float left = platform.left - shift;
+                    float right = platform.right - shift;
+                    if (right < obs.playerX - world.halfWidth || left > obs.playerX + world.halfWidth) continue;
+                    if (vy >= 0.f && previousBottom <= platform.top + 1.f && bottom >= platform.top) {
+                        y = platform.top - world.halfHeight;
+                        vy = 0.f;
+                        grounded = true;
+                        break;
+                    }
+                    if (bottom > platform.top && y - world.halfHeight < platform.top + 20.f) sideHits++;
+                }
+            }
+
+            // And GameSim::updatePlayers: walking off keeps the ground jump
+            // only for coyoteTime.
+            if (grounded) {
+                jumps = world.maxJumps;
+                coyote = world.coyoteTime;
+            } else if (world.coyoteTime >= 0.f && coyote >= 0.f && jumps == world.maxJumps && jumps > 0) {
+                coyote -= TICK;
+                if (coyote <= 0.f) {
+                    coyote = 0.f;
+                    jumps--;
+                }
+            }
+
+            if (y > world.deathY || y + world.halfHeight >= world.groundY) {
+                return -1e6f + tick * 1000.f + collected;
+            }
+
+            for (size_t i = 0; i < obs.collectibles.size() && i < 32; i++) {
+                if (takenMask & (1u << i)) continue;
+                const BotCollectible& item = obs.collectibles[i];
+                float itemX = item.x + item.vx * TICK * tick;
+                float itemY = item.y + item.vy * TICK * tick;
+                if (std::fabs(itemX - obs.playerX) < world.halfWidth + 20.f &&
+                    std::fabs(itemY - y) < world.halfHeight + 20.f) {
+                    takenMask |= 1u << i;
+                    collected += item.value;
+                }
+            }
+        }
+
+        float score = 10000.f + collected * 50.f - sideHits * 200.f - jumpsUsed * 2.f;
+        if (grounded) score += 500.f;
+        // Keep jumps in hand for whatever comes after the horizon.
+        score += jumps * 100.f;
+        return score;
+    }
+
+    bool supported(const BotObservation& obs, const BotWorld& world, float y, float shift) const {
+        float bottom = y + world.halfHeight;
+        for (const BotPlatform& platform : obs.platforms) {
+            float left = platform.left - shift;
+            float right = platform.right - shift;
+            if (right < obs.playerX - world.halfWidth * 0.9f || left > obs.playerX + world.halfWidth * 0.9f) continue;
+            if (std::fabs(bottom - platform.top) < 2.f) return true;
+        }
+        return false;
+    }
+
+    int cooldown = 0;
+};
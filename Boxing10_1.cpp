@@ -6,249 +6,134 @@
 #include <random>
 #include <fstream>
 #include <string>
-#include <algorithm> 
-#include <map> 
-#include <sstream> 
+#include <algorithm>
+#include <sstream>
+#include <ctime>
+#include <memory>
+#include <cstdlib>
+#include <chrono>
+#include "Tunables.h"
+#include "Leaderboard.h"
+#include "SoundPool.h"
+#include "GameSim.h"
+#include "Ghosts.h"
+#include "Netplay.h"
+#include "StateStream.h"
+#include "FramePacing.h"
+#include "Trace.h"
+#include "Counters.h"
+#include "Session.h"
+#include "Input.h"
+#include "Bot.h"
+#include "WorldBatch.h"
+#include "HudText.h"
+
+
+
+enum GameState { StartScreen, Connecting, PlayingSingle, PlayingMulti, GameOver };
+
+int main(int argc, char** argv) {
 
-
-
-const float PIXELS_PER_METER = 50.0f;
-const float METERS_PER_PIXEL = 1.0f / PIXELS_PER_METER;
-
-b2Vec2 toMeters(const sf::Vector2f& pixels) {
-    return b2Vec2(pixels.x * METERS_PER_PIXEL, pixels.y * METERS_PER_PIXEL);
-}
-
-sf::Vector2f toPixels(const b2Vec2& meters) {
-    return sf::Vector2f(meters.x * PIXELS_PER_METER, meters.y * PIXELS_PER_METER);
-}
-
-float lerp(float a, float b, float t) {
-    return a + t * (b - a);
-}
-
-
-struct Block { sf::RectangleShape shape; sf::RectangleShape line; b2Body* body = nullptr; bool markedForRemoval = false; uintptr_t id = 0; };
-enum CollectibleType { Magenta, Orange, Green, Red, White, MinusScore };
-struct Collectible { sf::Sprite sprite; CollectibleType type; b2Body* body = nullptr; bool markedForRemoval = false; };
-
-
-static constexpr uintptr_t PLAYER1_ID = 0; 
-static constexpr uintptr_t PLAYER2_ID = 10; 
-const uintptr_t FOOT_SENSOR_PLAYER1 = 5001;
-const uintptr_t FOOT_SENSOR_PLAYER2 = 5002;
-static constexpr uintptr_t GROUND_ID = 2;
-static constexpr uintptr_t CEILING_ID = 3;
-static constexpr uintptr_t MAGENTA_COLLECTIBLE_ID = 4;
-static constexpr uintptr_t ORANGE_COLLECTIBLE_ID = 5;
-static constexpr uintptr_t GREEN_COLLECTIBLE_ID = 6;
-static constexpr uintptr_t RED_COLLECTIBLE_ID = 7;
-static constexpr uintptr_t WHITE_COLLECTIBLE_ID = 8;
-static constexpr uintptr_t MINUS_SCORE_COLLECTIBLE_ID = 9;
-static constexpr uintptr_t PLATFORM_ID_BASE = 1000;
-
-
-class PlayerContactListener : public b2ContactListener {
-public:
-    std::map<uintptr_t, int> footContactsMap;
-    std::map<uintptr_t, bool> touchedGroundMap;
-    std::vector<b2Body*>& collectiblesToRemove;
-
-    PlayerContactListener(std::vector<b2Body*>& bodiesToRemove) : collectiblesToRemove(bodiesToRemove) {}
-
-    void BeginContact(b2Contact* contact) override {
-        b2Fixture* fixtureA = contact->GetFixtureA();
-        b2Fixture* fixtureB = contact->GetFixtureB();
-        uintptr_t userDataA = fixtureA->GetUserData().pointer;
-        uintptr_t userDataB = fixtureB->GetUserData().pointer;
-
-        // Platform Contact via Foot Sensor
-        checkFootContact(userDataA, userDataB, +1);
-        checkFootContact(userDataB, userDataA, +1);
-
-        // Ground Contact
-        if ((userDataA == PLAYER1_ID && userDataB == GROUND_ID) ||
-            (userDataB == PLAYER1_ID && userDataA == GROUND_ID)) {
-            touchedGroundMap[PLAYER1_ID] = true;
-        }
-
-        // Collectibles
-        if ((userDataA == PLAYER1_ID && isCollectible(userDataB)) ||
-            (userDataB == PLAYER1_ID && isCollectible(userDataA))) {
-            b2Body* collectibleBody = (userDataA == PLAYER1_ID) ? fixtureB->GetBody() : fixtureA->GetBody();
-            collectiblesToRemove.push_back(collectibleBody);
+    const unsigned int windowWidth = 1200;
+    const unsigned int windowHeight = 700;
+    Tunables tun = loadTunables("tunables.cfg");
+    TunablesWatcher tunablesWatcher("tunables.cfg");
+
+    // Network versus: --net <localPort> <remoteHost> <remotePort> <player 1|2> [latencyMs] [lossPercent]
+    // The optional pair adds artificial lag and loss to what this side sends,
+    // for trying rollback out between two copies on one machine.
+    bool netConfigured = false;
+    uint16_t netLocalPort = 0;
+    uint16_t netRemotePort = 0;
+    std::string netRemoteHost;
+    int netSlot = 0;
+    LinkConditions netConditions;
+    // Live state stream: --stream unix:<socket path> or --stream <file or FIFO>
+    std::string streamTarget;
+    // Frame phase trace for chrome://tracing or Perfetto: --trace <file.json> [seconds]
+    std::string tracePath;
+    double traceSeconds = 30.0;
+    // Engine counters written to stdout every so often: --counters <seconds>
+    // Allocations are only counted in a build with -DRAT_RIDER_COUNT_ALLOCATIONS.
+    float countersLogSeconds = 0.f;
+    // Local rounds saved for Headless replays: --record <prefix>, giving <prefix>1.session, <prefix>2.session, ...
+    std::string recordPrefix;
+    // Plays a recorded session instead of reading the keyboard, as fast as it
+    // will draw, then exits with its frame times: --replay <file.session>
+    std::string replayPath;
+    // Frame pacing: --pacing limited|vsync|uncapped (F4 cycles them) and
+    // --refresh <Hz>, the display's refresh rate and the limited mode's target.
+    PacingMode pacingMode = PacingMode::Limited;
+    double refreshHz = 60.0;
+    // Players in a local versus round: --players <2-8>. Up to four share the
+    // keyboard in "2. Multiplayer"; any slot beyond that is a bot.
+    int versusPlayers = 2;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--net" && i + 4 < argc) {
+            netLocalPort = static_cast<uint16_t>(std::atoi(argv[i + 1]));
+            netRemoteHost = argv[i + 2];
+            netRemotePort = static_cast<uint16_t>(std::atoi(argv[i + 3]));
+            netSlot = (std::atoi(argv[i + 4]) == 2) ? 1 : 0;
+            netConfigured = true;
+            i += 4;
+            if (i + 1 < argc && argv[i + 1][0] != '-') netConditions.latencyMs = static_cast<float>(std::atof(argv[++i]));
+            if (i + 1 < argc && argv[i + 1][0] != '-') netConditions.lossRate = static_cast<float>(std::atof(argv[++i])) / 100.f;
+        } else if (std::string(argv[i]) == "--stream" && i + 1 < argc) {
+            streamTarget = argv[++i];
+        } else if (std::string(argv[i]) == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-') traceSeconds = std::atof(argv[++i]);
+        } else if (std::string(argv[i]) == "--counters" && i + 1 < argc) {
+            countersLogSeconds = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::string(argv[i]) == "--record" && i + 1 < argc) {
+            recordPrefix = argv[++i];
+        } else if (std::string(argv[i]) == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (std::string(argv[i]) == "--pacing" && i + 1 < argc) {
+            std::string name = argv[++i];
+            pacingMode = (name == "vsync") ? PacingMode::VSync : (name == "uncapped") ? PacingMode::Uncapped : PacingMode::Limited;
+        } else if (std::string(argv[i]) == "--refresh" && i + 1 < argc) {
+            refreshHz = std::max(1.0, std::atof(argv[++i]));
+        } else if (std::string(argv[i]) == "--players" && i + 1 < argc) {
+            versusPlayers = std::min(std::max(std::atoi(argv[++i]), 2), MAX_PLAYERS);
         }
     }
-
-    void EndContact(b2Contact* contact) override {
-        b2Fixture* fixtureA = contact->GetFixtureA();
-        b2Fixture* fixtureB = contact->GetFixtureB();
-        uintptr_t userDataA = fixtureA->GetUserData().pointer;
-        uintptr_t userDataB = fixtureB->GetUserData().pointer;
-
-        // Remove Platform Contact via Foot Sensor
-        checkFootContact(userDataA, userDataB, -1);
-        checkFootContact(userDataB, userDataA, -1);
-
-        // Leaving ground
-        if ((userDataA == PLAYER1_ID && userDataB == GROUND_ID) ||
-            (userDataB == PLAYER1_ID && userDataA == GROUND_ID)) {
-            touchedGroundMap[PLAYER1_ID] = false;
-        }
+    if (!tracePath.empty() && Tracer::instance().start(tracePath, traceSeconds)) {
+        Tracer::instance().nameThread("main");
     }
-
-    void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override {
-        b2Fixture* fixtureA = contact->GetFixtureA();
-        b2Fixture* fixtureB = contact->GetFixtureB();
-        uintptr_t userDataA = fixtureA->GetUserData().pointer;
-        uintptr_t userDataB = fixtureB->GetUserData().pointer;
-
-        if (((userDataA == PLAYER1_ID || userDataA == PLAYER2_ID) && userDataB >= PLATFORM_ID_BASE) ||
-            ((userDataB == PLAYER1_ID || userDataB == PLAYER2_ID) && userDataA >= PLATFORM_ID_BASE)) {
-            contact->SetFriction(0.0f);
+    StateStream stateStream;
+    if (!streamTarget.empty()) stateStream.open(streamTarget);
+
+    bool replaying = !replayPath.empty();
+    SessionRecording replayRecording;
+    size_t replayTick = 0;
+    FrameTimeHistogram replayFrameTimes;
+    if (replaying) {
+        if (!loadSession(replayPath, replayRecording)) return 1;
+        if (replayRecording.ticks.empty()) {
+            std::cerr << "Error: session '" << replayPath << "' has no ticks" << std::endl;
+            return 1;
         }
-    }
-
-    bool isGrounded(uintptr_t playerId) const {
-        auto it = footContactsMap.find(playerId);
-        return (it != footContactsMap.end() && it->second > 0);
-    }
-
-    bool hasTouchedGround(uintptr_t playerId) const {
-        auto it = touchedGroundMap.find(playerId);
-        return (it != touchedGroundMap.end() && it->second);
-    }
-
-    void reset() {
-        footContactsMap.clear();
-        touchedGroundMap.clear();
-        collectiblesToRemove.clear();
-    }
-
-private:
-    void checkFootContact(uintptr_t footSensorId, uintptr_t otherId, int change) {
-        if ((footSensorId == FOOT_SENSOR_PLAYER1 || footSensorId == FOOT_SENSOR_PLAYER2) &&
-            otherId >= PLATFORM_ID_BASE) {
-            
-            uintptr_t ownerId = (footSensorId == FOOT_SENSOR_PLAYER1) ? PLAYER1_ID : PLAYER2_ID;
-            footContactsMap[ownerId] += change;
-
-            // Avoid negative counts
-            if (footContactsMap[ownerId] < 0) footContactsMap[ownerId] = 0;
+        if (replayRecording.windowWidth != windowWidth || replayRecording.windowHeight != windowHeight) {
+            std::cerr << "Error: session '" << replayPath << "' was recorded with a different window size" << std::endl;
+            return 1;
         }
+        tun = replayRecording.tunables;
     }
 
-    bool isCollectible(uintptr_t id) const {
-        return (id == MAGENTA_COLLECTIBLE_ID || id == ORANGE_COLLECTIBLE_ID ||
-                id == GREEN_COLLECTIBLE_ID || id == RED_COLLECTIBLE_ID ||
-                id == WHITE_COLLECTIBLE_ID || id == MINUS_SCORE_COLLECTIBLE_ID);
-    }
-};
-
-
-
-int loadHighScore(const std::string& filename) {
-    std::ifstream file(filename);
-    int highscore = 0;
-    if (file.is_open()) {
-        file >> highscore;
-        file.close();
-    }
-    return highscore;
-}
-
-void saveHighScore(const std::string& filename, int highscore) {
-    std::ofstream file(filename);
-    if (file.is_open()) {
-        file << highscore;
-        file.close();
-    }
-}
-
-
-enum PlatformEffect { None, Lengthen, Shorten };
-
-
-enum GameState { StartScreen, PlayingSingle, PlayingMulti, GameOver };
-
-// Function to create a player body and fixtures
-b2Body* createPlayer(b2World& world, const sf::Vector2f& startPos, float playerWidth, float playerHeight, uintptr_t playerID, uintptr_t footSensorID) {
-    b2BodyDef playerBodyDef;
-    playerBodyDef.type = b2_dynamicBody;
-    playerBodyDef.position = toMeters(startPos);
-    playerBodyDef.fixedRotation = true;
-    playerBodyDef.allowSleep = false;
-    b2Body* playerBody = world.CreateBody(&playerBodyDef);
-
-    // Main player body fixture
-    b2PolygonShape playerBox;
-    playerBox.SetAsBox(toMeters(sf::Vector2f(playerWidth / 2.f, playerHeight / 2.f)).x, toMeters(sf::Vector2f(playerWidth / 2.f, playerHeight / 2.f)).y);
-    b2FixtureDef playerFixtureDef;
-    playerFixtureDef.shape = &playerBox;
-    playerFixtureDef.density = 1.0f;
-    playerFixtureDef.friction = 0.5f;
-    playerFixtureDef.restitution = 0.0f;
-    playerFixtureDef.userData.pointer = playerID;
-    playerBody->CreateFixture(&playerFixtureDef);
-
-    // Foot sensor fixture
-    b2PolygonShape footSensorBox;
-    b2Vec2 footSensorCenter = b2Vec2(0, toMeters(sf::Vector2f(0, playerHeight / 2.f)).y);
-    footSensorBox.SetAsBox(toMeters(sf::Vector2f(playerWidth / 2.f * 0.9f, 5.f)).x, toMeters(sf::Vector2f(playerWidth / 2.f * 0.9f, 5.f)).y, footSensorCenter, 0);
-    b2FixtureDef footSensorFixtureDef;
-    footSensorFixtureDef.shape = &footSensorBox;
-    footSensorFixtureDef.isSensor = true;
-    footSensorFixtureDef.userData.pointer = footSensorID;
-    playerBody->CreateFixture(&footSensorFixtureDef);
-
-    return playerBody;
-}
-
-int main() {
-    
-    const unsigned int windowWidth = 1200;
-    const unsigned int windowHeight = 700;
-    const float fixedHeight = 20.f;
-    const float baseMinLength = 100.f;
-    const float baseMaxLength = 300.f;
-    float minLength = baseMinLength;
-    float maxLength = baseMaxLength;
-    float blockSpeed = 200.f;
-    const float blockSpeedIncreaseFactor = 5.0f;
-    const float maxBlockSpeed = 600.f;
-    float minSpawnTime = 2.5f;
-    float maxSpawnTime = 3.5f;
-    const float minSpawnTimeBase = 0.8f;
-    const float maxSpawnTimeBase = 1.5f;
-    const float playerWidth = 60.f;
-    const float playerHeight = 80.f;
-    const float playerJumpForce = 500.0f;
-    const int maxJumps = 2;
-    float collectibleRadius = 25.f;
-    const float collectibleSpawnChance = 0.85f;
-    const float magentaCollectibleProb = 0.35f;
-    const float orangeCollectibleProb = 0.20f;
-    const float greenCollectibleProb = 0.125f;
-    const float redCollectibleProb = 0.125f;
-    const float whiteCollectibleProb = 0.05f;
-    const float minusScoreCollectibleProb = 0.15f;
-    const float platformEffectDuration = 10.0f;
-    const float lengthenFactor = 2.0f;
-    const float shortenFactor = 0.5f;
-    const float magentaRainDuration = 10.0f;
-    const float magentaRainSpawnInterval = 0.15f;
-    const float magentaRainSpeed = 400.0f;
-    const float fastFallGravityScale = 100.0f;
-
     sf::Color defaultBlockColor = sf::Color(255, 200, 0);
     sf::Color greenBlockColor = sf::Color::Green;
     sf::Color redBlockColor = sf::Color::Red;
 
-    
+
     sf::RenderWindow window(sf::VideoMode(windowWidth, windowHeight), "Rat Rider");
-    window.setFramerateLimit(60);
+    // Frames are paced by framePacer below, which reads the keyboard while
+    // it waits; SFML's own limiter sleeps too coarsely.
+    if (replaying) pacingMode = PacingMode::Uncapped;
+    window.setFramerateLimit(0);
+    window.setVerticalSyncEnabled(pacingMode == PacingMode::VSync);
+
 
-    
     sf::Texture backgroundTexture;
     if (!backgroundTexture.loadFromFile("silhouette.jpg")) {
         std::cerr << "Error loading background image 'silhouette.jpg'" << std::endl;
@@ -271,17 +156,17 @@ int main() {
         return 1;
     }
 
-    
+
     sf::Texture staticPlayer2Texture;
-     if (!staticPlayer2Texture.loadFromFile("Idle2.png")) { 
+     if (!staticPlayer2Texture.loadFromFile("Idle2.png")) {
         std::cerr << "Error loading texture 'Idle2.png'" << std::endl;
-        
+
         staticPlayer2Texture = staticPlayerTexture;
     }
     sf::Texture jumpPlayer2Texture;
-     if (!jumpPlayer2Texture.loadFromFile("Jump2.png")) { 
+     if (!jumpPlayer2Texture.loadFromFile("Jump2.png")) {
         std::cerr << "Error loading texture 'Jump2.png'" << std::endl;
-         
+
         jumpPlayer2Texture = jumpPlayerTexture;
     }
 
@@ -294,118 +179,193 @@ int main() {
     if (!collectibleTextures[4].loadFromFile("Cheese_Rain.png")) { std::cerr << "Error loading texture 'Cheese_Rain.png'" << std::endl; return 1; }
     if (!collectibleTextures[5].loadFromFile("Poison.png")) { std::cerr << "Error loading texture 'Poison.png'" << std::endl; return 1; }
 
-    
+
     sf::SoundBuffer collectBuffer;
     if (!collectBuffer.loadFromFile("collectible.wav")) { std::cerr << "Error loading sound 'collectible.wav'" << std::endl; }
-    sf::Sound collectSound;
-    collectSound.setBuffer(collectBuffer);
+    SoundPool soundPool(16);
+    soundPool.setCategoryLimit(SoundPickup, 4);
 
     sf::Music backgroundMusic;
     if (!backgroundMusic.openFromFile("background.ogg")) { std::cerr << "Error loading music 'background.ogg'" << std::endl; }
-    else { backgroundMusic.setLoop(true); backgroundMusic.setVolume(50); } 
+    else { backgroundMusic.setLoop(true); backgroundMusic.setVolume(50); }
+
 
-    
     sf::Font font;
     if (!font.loadFromFile("font.ttf")) { std::cerr << "Error loading font font.ttf" << std::endl; return 1; }
 
-    
-    b2Vec2 gravity(0.0f, 7.0f);
-    b2World world(gravity);
-
-    std::vector<b2Body*> collectiblesToRemoveFromWorld;
-    PlayerContactListener contactListener(collectiblesToRemoveFromWorld);
-    world.SetContactListener(&contactListener);
-
-    
-    b2BodyDef groundBodyDef;
-    groundBodyDef.position.Set(toMeters(sf::Vector2f(windowWidth / 2.f, windowHeight + 50.f)).x, toMeters(sf::Vector2f(windowWidth / 2.f, windowHeight + 50.f)).y);
-    b2Body* groundBody = world.CreateBody(&groundBodyDef);
-    b2PolygonShape groundBox;
-    groundBox.SetAsBox(toMeters(sf::Vector2f(windowWidth / 2.f, 10.f)).x, toMeters(sf::Vector2f(windowWidth / 2.f, 10.f)).y);
-    b2Fixture* groundFixture = groundBody->CreateFixture(&groundBox, 0.0f);
-    groundFixture->GetUserData().pointer = GROUND_ID;
-
-    b2BodyDef ceilingBodyDef;
-    ceilingBodyDef.position.Set(toMeters(sf::Vector2f(windowWidth / 2.f, -10.f)).x, toMeters(sf::Vector2f(windowWidth / 2.f, -10.f)).y);
-    b2Body* ceilingBody = world.CreateBody(&ceilingBodyDef);
-    b2PolygonShape ceilingBox;
-    ceilingBox.SetAsBox(toMeters(sf::Vector2f(windowWidth / 2.f, 10.f)).x, toMeters(sf::Vector2f(windowWidth / 2.f, 10.f)).y);
-    b2Fixture* ceilingFixture = ceilingBody->CreateFixture(&ceilingBox, 0.0f);
-    ceilingFixture->GetUserData().pointer = CEILING_ID;
-
-
-    
-    sf::Sprite playerSprite;
-    playerSprite.setTexture(staticPlayerTexture); 
-    playerSprite.setScale(playerWidth / staticPlayerTexture.getSize().x, playerHeight / staticPlayerTexture.getSize().y);
-    playerSprite.setOrigin(staticPlayerTexture.getSize().x / 2.f, staticPlayerTexture.getSize().y / 2.f); 
-    b2Body* playerBody = nullptr; 
-    int jumpsRemaining = maxJumps;
-    
-    bool fastFallActive = false;
-    bool player1Alive = true; 
-
-    
-    sf::Sprite player2Sprite;
-    player2Sprite.setTexture(staticPlayer2Texture); 
-    player2Sprite.setScale(playerWidth / staticPlayer2Texture.getSize().x, playerHeight / staticPlayer2Texture.getSize().y);
-    player2Sprite.setOrigin(staticPlayer2Texture.getSize().x / 2.f, staticPlayer2Texture.getSize().y / 2.f); 
-    b2Body* player2Body = nullptr; 
-    int jumpsRemaining2 = maxJumps;
-    
-    bool fastFallActive2 = false;
-    bool player2Alive = true; 
-
-    int winner = 0; 
-
-    
-    std::vector<Block> blocks;
-    std::vector<Collectible> collectibles;
-    uintptr_t nextPlatformId = PLATFORM_ID_BASE;
-
-    
+
+    // The simulation owns the world and every body; this loop feeds it input and draws it.
+    GameSim sim(tun, static_cast<float>(windowWidth), static_cast<float>(windowHeight));
+
+
+
+    // One sprite per player slot. Players 1 and 2 have their own art; later
+    // slots take turns with it, tinted so everyone can find themselves.
+    const sf::Color playerTints[MAX_PLAYERS] = {
+        sf::Color::White, sf::Color::White, sf::Color(255, 160, 160), sf::Color(160, 255, 160),
+        sf::Color(160, 190, 255), sf::Color(255, 240, 140), sf::Color(140, 240, 255), sf::Color(255, 150, 255)
+    };
+    const sf::Texture* playerIdleTextures[MAX_PLAYERS];
+    const sf::Texture* playerJumpTextures[MAX_PLAYERS];
+    sf::Sprite playerSprites[MAX_PLAYERS];
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        playerIdleTextures[i] = (i % 2 == 0) ? &staticPlayerTexture : &staticPlayer2Texture;
+        playerJumpTextures[i] = (i % 2 == 0) ? &jumpPlayerTexture : &jumpPlayer2Texture;
+        sf::Vector2u size = playerIdleTextures[i]->getSize();
+        playerSprites[i].setTexture(*playerIdleTextures[i]);
+        playerSprites[i].setScale(tun.playerWidth / size.x, tun.playerHeight / size.y);
+        playerSprites[i].setOrigin(size.x / 2.f, size.y / 2.f);
+        playerSprites[i].setColor(playerTints[i]);
+    }
+
+    // Platforms and collectibles, rebuilt from the simulation every frame and drawn in two calls.
+    WorldBatch worldBatch;
+    if (!worldBatch.init(collectibleTextures, tun.collectibleRadius, defaultBlockColor, greenBlockColor, redBlockColor)) return 1;
+
+
     GameState currentState = GameState::StartScreen;
-    sf::Clock spawnClock;
-    float nextSpawnTime = 0; 
-    sf::Clock deltaClock;
-    float gameTime = 0.f;
-
-    sf::Clock playerAnimClock;
-    sf::Clock player2AnimClock;
-
-    
-    int score = 0;
-    int highScore = loadHighScore("highscore.txt");
-    PlatformEffect currentPlatformEffect = PlatformEffect::None;
-    sf::Clock platformEffectClock;
-    bool isRainingMagenta = false;
-    sf::Clock magentaRainClock;
-    sf::Clock magentaRainSpawnClock;
-
-    
+
+    // Window events with the time they were read. The queue is drained at the
+    // start of each frame and every millisecond while the frame waits, so a
+    // key press is timed to within about a millisecond, not a frame.
+    struct TimedEvent {
+        sf::Event event;
+        sf::Int64 micros;
+    };
+    std::vector<TimedEvent> timedEvents;
+    timedEvents.reserve(64);
+    sf::Clock inputClock;
+    auto pumpEvents = [&]() {
+        sf::Event event;
+        while (window.pollEvent(event)) timedEvents.push_back(TimedEvent{ event, inputClock.getElapsedTime().asMicroseconds() });
+    };
+
+    // Gameplay keys go into the timeline and reach the simulation at the
+    // fixed tick their timestamp falls in. tickedUntil is the input clock
+    // time the simulation has been advanced to, one NET_TICK per tick, local
+    // and network games alike.
+    InputTimeline inputTimeline;
+    const sf::Int64 tickMicros = static_cast<sf::Int64>(NET_TICK * 1000000.f);
+    const int maxTicksPerFrame = 6;     // after a hitch, the rest of the time is let go
+    sf::Int64 tickedUntil = 0;
+    auto startTicking = [&]() {
+        inputTimeline.clear();
+        tickedUntil = inputClock.getElapsedTime().asMicroseconds();
+    };
+
+    // Idle: on the start and game-over screens nothing moves, and a local
+    // game is paused while the window is out of focus, so the loop waits for
+    // events instead of pacing frames, and draws only when one arrives or a
+    // second has passed. SFML 2's waitEvent() cannot time out, so the wait
+    // polls every 16 ms, which costs next to nothing. The timeout is kept in
+    // real time: under RevisionShim.h sf::Clock only moves when a frame is
+    // shown. The bench scripts its input per shown frame and times every
+    // frame, so under the shim the loop never idles at all.
+    bool windowFocused = true;
+#ifdef RAT_RIDER_REVISION_SHIM
+    const bool idleAllowed = false;
+#else
+    const bool idleAllowed = true;
+#endif
+    auto waitForEvents = [&](std::chrono::milliseconds timeout) {
+        std::chrono::steady_clock::time_point waitEnd = std::chrono::steady_clock::now() + timeout;
+        pumpEvents();
+        while (timedEvents.empty() && std::chrono::steady_clock::now() < waitEnd) {
+            sf::sleep(sf::milliseconds(16));
+            pumpEvents();
+        }
+    };
+
+    // Input for each player, filled from the timeline or by a bot. The first
+    // keyboardPlayers slots read their keys below; F1 toggles the autopilot
+    // for player 1, and "3. Versus Bot" gives every other slot a bot.
+    struct KeyBinding {
+        sf::Keyboard::Key jump;
+        sf::Keyboard::Key fastFall;
+    };
+    const KeyBinding keyBindings[] = {
+        { sf::Keyboard::W, sf::Keyboard::S }, { sf::Keyboard::Up, sf::Keyboard::Down },
+        { sf::Keyboard::I, sf::Keyboard::K }, { sf::Keyboard::Numpad8, sf::Keyboard::Numpad5 }
+    };
+    const int maxKeyboardPlayers = static_cast<int>(sizeof(keyBindings) / sizeof(keyBindings[0]));
+    int keyboardPlayers = 1;
+    PlayerInput inputs[MAX_PLAYERS];
+    bool botEnabled[MAX_PLAYERS] = {};
+    std::vector<JumpBot> bots(MAX_PLAYERS);
+    BotObservation botObservation;
+    BotWorld botWorld = makeBotWorld(tun, PIXELS_PER_METER, static_cast<float>(windowHeight));
+
+
+    Leaderboard leaderboard("leaderboard.bin", 10, "highscore.txt");
+    int highScore = leaderboard.bestScore();
+
+    // Single-player runs race translucent replays of the best previous runs.
+    GhostLibrary ghostLibrary("ghosts.bin", 100);
+    GhostRecorder ghostRecorder;
+    GhostRenderer ghostRenderer;
+    SessionRecorder sessionRecorder;
+    int sessionsRecorded = 0;
+    bool ghostsEnabled = !replaying && ghostRenderer.init(staticPlayerTexture, jumpPlayerTexture, tun.playerWidth, tun.playerHeight, 100);
+
+
     std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> yPosDist(windowHeight - 450u, windowHeight - 150u);
-    std::uniform_real_distribution<float> initialSpawnTimeDist(0.5f, 1.5f);
-    std::uniform_real_distribution<float> collectibleTypeDist(0.0f, 1.0f);
-    std::uniform_real_distribution<float> rainXPosDist(collectibleRadius, windowWidth - collectibleRadius);
+
+    // "4. Network Versus": the shared GameSim is driven by a rollback session
+    // at a fixed 60 Hz instead of by the frame time.
+    UdpLink netLink;
+    std::unique_ptr<RollbackSession> netSession;
+    bool netGame = false;
+    uint32_t netSeed = 0;
+    sf::Clock netClock;
+    // Leaving a finished network round waits until the peer has what it
+    // needs to confirm the ending too, or gives up on it after a while.
+    const float NET_LEAVE_TIMEOUT = 3.f;
+    bool netLeaveRequested = false;
+    float netRoundEndedAt = 0.f;
 
 
-    
     sf::Text gameOverText("Game Over!", font, 50);
     gameOverText.setFillColor(sf::Color::Red);
     gameOverText.setStyle(sf::Text::Bold);
-    
 
-    sf::Text scoreText("Score 0", font, 30);
-    scoreText.setFillColor(sf::Color::White);
-    scoreText.setPosition(25.f, 10.f);
 
-    sf::Text highScoreText("High Score 0", font, 30);
-    highScoreText.setFillColor(sf::Color::White);
-    highScoreText.setPosition(930.f, 10.f);
+    sf::Text leaderboardText("", font, 26);
+    leaderboardText.setFillColor(sf::Color::White);
+    bool showLeaderboard = false;
+
+    HudCounter scoreCounter;
+    scoreCounter.init(font, 30, "Score", sf::Vector2f(25.f, 10.f), 2, sf::Color::White);
+    HudCounter highScoreCounter;
+    highScoreCounter.init(font, 30, "High Score", sf::Vector2f(930.f, 10.f), 4, sf::Color::White);
+
+    // F3 shows frame pacing for the last half second and the engine counters
+    // for the last frame; the pacing of the whole session is summarised on exit.
+    FramePacingMonitor framePacing(static_cast<float>(refreshHz));
+    FramePacer framePacer(pacingMode, refreshHz);
+    sf::Int64 pressAwaitingPhoton = -1;     // earliest key press simulated but not yet shown
+    sf::Clock frameClock;
+    sf::Clock pacingWindowClock;
+    bool showOverlay = false;
+    sf::Text pacingText("", font, 16);
+    pacingText.setFillColor(sf::Color::White);
+    pacingText.setPosition(25.f, 560.f);
+    EngineCounters engineCounters;
+    sf::Clock countersLogClock;
+    sf::Text countersText("", font, 16);
+    countersText.setFillColor(sf::Color::White);
+    countersText.setPosition(760.f, 600.f);
+
+    // Every draw goes through these so the counters see it.
+    auto drawSprite = [&](const sf::Sprite& sprite) {
+        window.draw(sprite);
+        engineCounters.countDraw(sprite.getTexture());
+    };
+    auto drawText = [&](const sf::Text& text) {
+        window.draw(text);
+        engineCounters.countDraw(&font.getTexture(text.getCharacterSize()));
+    };
+
 
-    
     sf::Text titleText("Rat Rider", font, 80);
     titleText.setFillColor(sf::Color::Yellow);
     titleText.setStyle(sf::Text::Bold);
@@ -419,803 +379,425 @@ int main() {
     multiPlayerText.setFillColor(sf::Color::White);
     multiPlayerText.setPosition(windowWidth / 2.f - multiPlayerText.getLocalBounds().width / 2.f, windowHeight / 2.f + 20.f);
 
+    sf::Text versusBotText("3. Versus Bot", font, 40);
+    versusBotText.setFillColor(sf::Color::White);
+    versusBotText.setPosition(windowWidth / 2.f - versusBotText.getLocalBounds().width / 2.f, windowHeight / 2.f + 90.f);
+
+    sf::Text networkText("4. Network Versus", font, 40);
+    networkText.setFillColor(sf::Color::White);
+    networkText.setPosition(windowWidth / 2.f - networkText.getLocalBounds().width / 2.f, windowHeight / 2.f + 160.f);
+
+    sf::Text connectingText("Waiting for the other player...", font, 40);
+    connectingText.setFillColor(sf::Color::White);
+    connectingText.setPosition(windowWidth / 2.f - connectingText.getLocalBounds().width / 2.f, windowHeight / 2.f);
+
+
+
+    sf::Clock sessionClock;
+    std::clock_t cpuStart = std::clock();
+    if (replaying) {
+        currentState = (replayRecording.mode == VersusMode) ? GameState::PlayingMulti : GameState::PlayingSingle;
+        sim.startRound(replayRecording.mode, replayRecording.seed, replayRecording.playerCount);
+    }
 
-    
     while (window.isOpen()) {
-        sf::Event event;
-        while (window.pollEvent(event)) {
+        bool playing = currentState == GameState::PlayingSingle || currentState == GameState::PlayingMulti;
+        // Network games never idle: the other side keeps playing.
+        bool idle = idleAllowed && !replaying && !netGame && currentState != GameState::Connecting &&
+                    (!windowFocused || currentState == GameState::StartScreen || currentState == GameState::GameOver);
+        if (idle) {
+            TraceScope traceIdle("idle");
+            waitForEvents(std::chrono::seconds(1));
+        } else {
+            TraceScope traceWait("frame wait");
+            framePacer.waitForFrame(pumpEvents);
+        }
+        framePacer.workStarted();
+        engineCounters.beginFrame();
+
+        // Hot reload of tunables.cfg. Bodies already in the world keep their
+        // size; new spawns, speeds, timers and probabilities use the new values.
+        // Not during a network game: both sides must simulate with the same values.
+        if (!netGame && !replaying && tunablesWatcher.poll()) {
+            if (!tryLoadTunables("tunables.cfg", tun)) {
+                std::cerr << "Error reloading tunables.cfg: keeping the previous values" << std::endl;
+            } else {
+                sim.setTunables(tun);
+                if (sessionRecorder.isActive()) {
+                    sessionRecorder.abandon();
+                    std::cout << "Round no longer recorded: tunables changed mid-round" << std::endl;
+                }
+                botWorld = makeBotWorld(tun, PIXELS_PER_METER, static_cast<float>(windowHeight));
+                std::cout << "Reloaded tunables.cfg" << std::endl;
+            }
+        }
+
+        soundPool.beginFrame();
+
+        TraceScope traceInput("input");
+        pumpEvents();
+        for (const TimedEvent& timed : timedEvents) {
+            const sf::Event& event = timed.event;
             if (event.type == sf::Event::Closed)
                 window.close();
-    
-            if (currentState == GameState::StartScreen) {
-                if (event.type == sf::Event::KeyPressed) {
-                    if (event.key.code == sf::Keyboard::Num1) {
-                        currentState = GameState::PlayingSingle;
-                        score = 0;
-                        highScore = loadHighScore("highscore.txt");
-                        blocks.clear();
-                        collectibles.clear();
-                        collectiblesToRemoveFromWorld.clear();
-                        contactListener.reset();
-                        gameTime = 0.f;
-                        blockSpeed = 200.f;
-                        minLength = baseMinLength;
-                        maxLength = baseMaxLength;
-                        minSpawnTime = 2.5f;
-                        maxSpawnTime = 3.5f;
-                        currentPlatformEffect = PlatformEffect::None;
-                        isRainingMagenta = false;
-                        spawnClock.restart();
-                        deltaClock.restart();
-                        backgroundMusic.play();
-    
-                        b2BodyDef playerBodyDef;
-                        playerBodyDef.type = b2_dynamicBody;
-                        playerBodyDef.position = toMeters(sf::Vector2f(windowWidth / 4.f, windowHeight - 600.f));
-                        playerBodyDef.fixedRotation = true;
-                        playerBodyDef.allowSleep = false;
-                        playerBody = world.CreateBody(&playerBodyDef);
-    
-                        b2PolygonShape playerBox;
-                        playerBox.SetAsBox(toMeters(sf::Vector2f(playerWidth / 2.f, playerHeight / 2.f)).x, toMeters(sf::Vector2f(playerWidth / 2.f, playerHeight / 2.f)).y);
-                        b2FixtureDef playerFixtureDef;
-                        playerFixtureDef.shape = &playerBox;
-                        playerFixtureDef.density = 1.0f;
-                        playerFixtureDef.friction = 0.5f;
-                        playerFixtureDef.restitution = 0.0f;
-                        playerFixtureDef.userData.pointer = PLAYER1_ID;
-                        playerBody->CreateFixture(&playerFixtureDef);
-    
-                        b2PolygonShape footSensorBox;
-                        b2Vec2 footSensorCenter = b2Vec2(0, toMeters(sf::Vector2f(0, playerHeight / 2.f)).y);
-                        footSensorBox.SetAsBox(toMeters(sf::Vector2f(playerWidth / 2.f * 0.9f, 5.f)).x, toMeters(sf::Vector2f(playerWidth / 2.f * 0.9f, 5.f)).y, footSensorCenter, 0);
-                        b2FixtureDef footSensorFixtureDef;
-                        footSensorFixtureDef.shape = &footSensorBox;
-                        footSensorFixtureDef.isSensor = true;
-                        footSensorFixtureDef.userData.pointer = FOOT_SENSOR_PLAYER1;
-                        playerBody->CreateFixture(&footSensorFixtureDef);
-    
-                        playerSprite.setTexture(staticPlayerTexture);
-                        jumpsRemaining = maxJumps;
-                        fastFallActive = false;
-                        player1Alive = true;
-                        playerAnimClock.restart();
-    
-                        Block initialBlock;
-                        float initialBlockLength = windowWidth - 250.f ;
-                        sf::Vector2f initialSpawnPos(windowWidth / 2.f, windowHeight - 500.f);
-                        initialBlock.shape.setSize(sf::Vector2f(initialBlockLength, fixedHeight));
-                        initialBlock.shape.setFillColor(defaultBlockColor);
-                        initialBlock.shape.setOutlineColor(sf::Color::Black);
-                        initialBlock.shape.setOutlineThickness(2.5f);
-                        initialBlock.shape.setOrigin(initialBlockLength / 2.f, fixedHeight / 2.f);
-                        initialBlock.shape.setPosition(initialSpawnPos);
-                        initialBlock.line.setSize(sf::Vector2f(15.f, 500));
-                        initialBlock.line.setFillColor(sf::Color(150,150,150));
-                        initialBlock.line.setOutlineColor(sf::Color::Black);
-                        initialBlock.line.setOutlineThickness(2.5f);
-                        initialBlock.line.setOrigin(7.5f, 0.f);
-                        initialBlock.line.setPosition(initialSpawnPos.x, initialSpawnPos.y + fixedHeight / 2.f);
-    
-                        b2BodyDef initialBlockBodyDef;
-                        initialBlockBodyDef.type = b2_kinematicBody;
-                        initialBlockBodyDef.position = toMeters(initialSpawnPos);
-                        initialBlock.body = world.CreateBody(&initialBlockBodyDef);
-                        initialBlock.id = nextPlatformId++;
-    
-                        b2PolygonShape initialBlockBox;
-                        initialBlockBox.SetAsBox(toMeters(sf::Vector2f(initialBlockLength / 2.f, fixedHeight / 2.f)).x, toMeters(sf::Vector2f(initialBlockLength / 2.f, fixedHeight / 2.f)).y);
-                        b2FixtureDef initialBlockFixtureDef;
-                        initialBlockFixtureDef.shape = &initialBlockBox;
-                        initialBlockFixtureDef.friction = 0.7f;
-                        initialBlockFixtureDef.userData.pointer = initialBlock.id;
-                        initialBlock.body->CreateFixture(&initialBlockFixtureDef);
-    
-                        // Set initial block velocity to move left
-                        initialBlock.body->SetLinearVelocity(b2Vec2(toMeters(sf::Vector2f(-blockSpeed, 0.f)).x, 0.0f));
-                        blocks.push_back(initialBlock);
-    
-                    } else if (event.key.code == sf::Keyboard::Num2) {
-                        currentState = GameState::PlayingMulti;
-                        blocks.clear();
-                        collectibles.clear();
-                        collectiblesToRemoveFromWorld.clear();
-                        contactListener.reset();
-                        gameTime = 0.f;
-                        blockSpeed = 200.f;
-                        minLength = baseMinLength;
-                        maxLength = baseMaxLength;
-                        minSpawnTime = 2.5f;
-                        maxSpawnTime = 3.5f;
-                        currentPlatformEffect = PlatformEffect::None;
-                        isRainingMagenta = false;
-                        spawnClock.restart();
-                        deltaClock.restart();
+            if (event.type == sf::Event::LostFocus || event.type == sf::Event::GainedFocus) {
+                windowFocused = event.type == sf::Event::GainedFocus;
+                if (playing && !netGame && !replaying) {
+                    if (windowFocused) {
+                        // Resume where it stopped rather than catching up the pause.
+                        startTicking();
                         backgroundMusic.play();
-                        winner = 0;
-    
-                        b2BodyDef playerBodyDef;
-                        playerBodyDef.type = b2_dynamicBody;
-                        playerBodyDef.position = toMeters(sf::Vector2f(windowWidth / 4.f, windowHeight - 600.f));
-                        playerBodyDef.fixedRotation = true;
-                        playerBodyDef.allowSleep = false;
-                        playerBody = world.CreateBody(&playerBodyDef);
-    
-                        b2PolygonShape playerBox;
-                        playerBox.SetAsBox(toMeters(sf::Vector2f(playerWidth / 2.f, playerHeight / 2.f)).x, toMeters(sf::Vector2f(playerWidth / 2.f, playerHeight / 2.f)).y);
-                        b2FixtureDef playerFixtureDef;
-                        playerFixtureDef.shape = &playerBox;
-                        playerFixtureDef.density = 1.0f;
-                        playerFixtureDef.friction = 0.5f;
-                        playerFixtureDef.restitution = 0.0f;
-                        playerFixtureDef.userData.pointer = PLAYER1_ID;
-                        playerBody->CreateFixture(&playerFixtureDef);
-    
-                        b2PolygonShape footSensorBox;
-                        b2Vec2 footSensorCenter = b2Vec2(0, toMeters(sf::Vector2f(0, playerHeight / 2.f)).y);
-                        footSensorBox.SetAsBox(toMeters(sf::Vector2f(playerWidth / 2.f * 0.9f, 5.f)).x, toMeters(sf::Vector2f(playerWidth / 2.f * 0.9f, 5.f)).y, footSensorCenter, 0);
-                        b2FixtureDef footSensorFixtureDef;
-                        footSensorFixtureDef.shape = &footSensorBox;
-                        footSensorFixtureDef.isSensor = true;
-                        footSensorFixtureDef.userData.pointer = FOOT_SENSOR_PLAYER1;
-                        playerBody->CreateFixture(&footSensorFixtureDef);
-    
-                        playerSprite.setTexture(staticPlayerTexture);
-                        jumpsRemaining = maxJumps;
-                        fastFallActive = false;
-                        player1Alive = true;
-                        playerAnimClock.restart();
-    
-                        b2BodyDef player2BodyDef;
-                        player2BodyDef.type = b2_dynamicBody;
-                        player2BodyDef.position = toMeters(sf::Vector2f(windowWidth / 4.f - 100.f, windowHeight - 600.f));
-                        player2BodyDef.fixedRotation = true;
-                        player2BodyDef.allowSleep = false;
-                        player2Body = world.CreateBody(&player2BodyDef);
-    
-                        b2PolygonShape player2Box;
-                        player2Box.SetAsBox(toMeters(sf::Vector2f(playerWidth / 2.f, playerHeight / 2.f)).x, toMeters(sf::Vector2f(playerWidth / 2.f, playerHeight / 2.f)).y);
-                        b2FixtureDef player2FixtureDef;
-                        player2FixtureDef.shape = &player2Box;
-                        player2FixtureDef.density = 1.0f;
-                        player2FixtureDef.friction = 0.5f;
-                        player2FixtureDef.restitution = 0.0f;
-                        player2FixtureDef.userData.pointer = PLAYER2_ID;
-                        player2Body->CreateFixture(&player2FixtureDef);
-    
-                        b2PolygonShape footSensor2Box;
-                        b2Vec2 footSensor2Center = b2Vec2(0, toMeters(sf::Vector2f(0, playerHeight / 2.f)).y);
-                        footSensor2Box.SetAsBox(toMeters(sf::Vector2f(playerWidth / 2.f * 0.9f, 5.f)).x, toMeters(sf::Vector2f(playerWidth / 2.f * 0.9f, 5.f)).y, footSensor2Center, 0);
-                        b2FixtureDef footSensor2FixtureDef;
-                        footSensor2FixtureDef.shape = &footSensor2Box;
-                        footSensor2FixtureDef.isSensor = true;
-                        footSensor2FixtureDef.userData.pointer = FOOT_SENSOR_PLAYER2;
-                        player2Body->CreateFixture(&footSensor2FixtureDef);
-    
-                        player2Sprite.setTexture(staticPlayer2Texture);
-                        jumpsRemaining2 = maxJumps;
-                        fastFallActive2 = false;
-                        player2Alive = true;
-                        player2AnimClock.restart();
-    
-                        Block initialBlock;
-                        float initialBlockLength = windowWidth - 250.f ;
-                        sf::Vector2f initialSpawnPos(windowWidth / 2.f, windowHeight - 500.f);
-                        initialBlock.shape.setSize(sf::Vector2f(initialBlockLength, fixedHeight));
-                        initialBlock.shape.setFillColor(defaultBlockColor);
-                        initialBlock.shape.setOutlineColor(sf::Color::Black);
-                        initialBlock.shape.setOutlineThickness(2.5f);
-                        initialBlock.shape.setOrigin(initialBlockLength / 2.f, fixedHeight / 2.f);
-                        initialBlock.shape.setPosition(initialSpawnPos);
-                        initialBlock.line.setSize(sf::Vector2f(15.f, 500));
-                        initialBlock.line.setFillColor(sf::Color(150,150,150));
-                        initialBlock.line.setOutlineColor(sf::Color::Black);
-                        initialBlock.line.setOutlineThickness(2.5f);
-                        initialBlock.line.setOrigin(7.5f, 0.f);
-                        initialBlock.line.setPosition(initialSpawnPos.x, initialSpawnPos.y + fixedHeight / 2.f);
-    
-                        b2BodyDef initialBlockBodyDef;
-                        initialBlockBodyDef.type = b2_kinematicBody;
-                        initialBlockBodyDef.position = toMeters(initialSpawnPos);
-                        initialBlock.body = world.CreateBody(&initialBlockBodyDef);
-                        initialBlock.id = nextPlatformId++;
-    
-                        b2PolygonShape initialBlockBox;
-                        initialBlockBox.SetAsBox(toMeters(sf::Vector2f(initialBlockLength / 2.f, fixedHeight / 2.f)).x, toMeters(sf::Vector2f(initialBlockLength / 2.f, fixedHeight / 2.f)).y);
-                        b2FixtureDef initialBlockFixtureDef;
-                        initialBlockFixtureDef.shape = &initialBlockBox;
-                        initialBlockFixtureDef.friction = 0.7f;
-                        initialBlockFixtureDef.userData.pointer = initialBlock.id;
-                        initialBlock.body->CreateFixture(&initialBlockFixtureDef);
-    
-                        // Set initial block velocity to move left
-                        initialBlock.body->SetLinearVelocity(b2Vec2(toMeters(sf::Vector2f(-blockSpeed, 0.f)).x, 0.0f));
-                        blocks.push_back(initialBlock);
+                    } else {
+                        backgroundMusic.pause();
                     }
                 }
-            } else if (currentState == GameState::PlayingSingle) {
+            }
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3)
+                showOverlay = !showOverlay;
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F4 && !replaying) {
+                PacingMode next = (framePacer.pacingMode() == PacingMode::Limited) ? PacingMode::VSync :
+                                  (framePacer.pacingMode() == PacingMode::VSync) ? PacingMode::Uncapped : PacingMode::Limited;
+                framePacer.setMode(next);
+                window.setVerticalSyncEnabled(next == PacingMode::VSync);
+                std::cout << "Frame pacing: " << pacingModeName(next) << std::endl;
+            }
+
+            if (currentState == GameState::StartScreen) {
                 if (event.type == sf::Event::KeyPressed) {
-                    if (event.key.code == sf::Keyboard::W) {
-                        if (playerBody && jumpsRemaining > 0) {
-                            float impulseMagnitude = playerJumpForce * METERS_PER_PIXEL * playerBody->GetMass();
-                            playerBody->ApplyLinearImpulseToCenter(b2Vec2(0, -impulseMagnitude), true);
-                            jumpsRemaining--;
+                    bool single = event.key.code == sf::Keyboard::Num1;
+                    bool multi = event.key.code == sf::Keyboard::Num2 || event.key.code == sf::Keyboard::Num3;
+                    if (single || multi) {
+                        currentState = single ? GameState::PlayingSingle : GameState::PlayingMulti;
+                        bool versusBots = event.key.code == sf::Keyboard::Num3;
+                        keyboardPlayers = (single || versusBots) ? 1 : std::min(versusPlayers, maxKeyboardPlayers);
+                        for (int p = 1; p < MAX_PLAYERS; p++) botEnabled[p] = p >= keyboardPlayers;
+                        showLeaderboard = false;
+                        highScore = leaderboard.bestScore();
+                        sim.startRound(single ? SinglePlayerMode : VersusMode, rd(), versusPlayers);
+                        if (!recordPrefix.empty()) sessionRecorder.begin(sim);
+                        if (single && ghostsEnabled) {
+                            ghostRecorder.begin(sim.roundSeed);
+                            ghostRenderer.start(ghostLibrary.tracks());
                         }
-                    } else if (event.key.code == sf::Keyboard::S ) {
-                        fastFallActive = true;
+                        startTicking();
+                        backgroundMusic.play();
                     }
-                }
-                if (event.type == sf::Event::KeyReleased) {
-                    if (event.key.code == sf::Keyboard::S) {
-                        fastFallActive = false;
+                    if (event.key.code == sf::Keyboard::Num4 && netConfigured &&
+                        (netLink.isOpen() || netLink.open(netLocalPort, netRemoteHost, netRemotePort))) {
+                        netLink.setConditions(netConditions, rd());
+                        netSession.reset(new RollbackSession(sim, netLink, netSlot));
+                        netSeed = rd();
+                        netClock.restart();
+                        currentState = GameState::Connecting;
                     }
                 }
-            } else if (currentState == GameState::PlayingMulti) {
-                if (event.type == sf::Event::KeyPressed) {
-                    if (event.key.code == sf::Keyboard::W) {
-                        if (playerBody && jumpsRemaining > 0) {
-                            float impulseMagnitude = playerJumpForce * METERS_PER_PIXEL * playerBody->GetMass();
-                            playerBody->ApplyLinearImpulseToCenter(b2Vec2(0, -impulseMagnitude), true);
-                            jumpsRemaining--;
-                        }
-                    } else if (event.key.code == sf::Keyboard::S ) {
-                        fastFallActive = true;
-                    }
-                    if (event.key.code == sf::Keyboard::Up) {
-                        if (player2Body && jumpsRemaining2 > 0) {
-                            float impulseMagnitude = playerJumpForce * METERS_PER_PIXEL * player2Body->GetMass();
-                            player2Body->ApplyLinearImpulseToCenter(b2Vec2(0, -impulseMagnitude), true);
-                            jumpsRemaining2--;
-                        }
-                    } else if (event.key.code == sf::Keyboard::Down ) {
-                        fastFallActive2 = true;
-                    }
+            } else if (currentState == GameState::Connecting) {
+                if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape) {
+                    netSession.reset();
+                    currentState = GameState::StartScreen;
                 }
-                if (event.type == sf::Event::KeyReleased) {
-                    if (event.key.code == sf::Keyboard::S) {
-                        fastFallActive = false;
-                    }
-                    if (event.key.code == sf::Keyboard::Down) {
-                        fastFallActive2 = false;
+            } else if (currentState == GameState::GameOver && !netGame && !replaying) {
+                if (event.type == sf::Event::KeyPressed &&
+                    (event.key.code == sf::Keyboard::Space || event.key.code == sf::Keyboard::Enter)) {
+                    showLeaderboard = false;
+                    currentState = GameState::StartScreen;
+                }
+            } else if (currentState == GameState::GameOver && netGame) {
+                if (event.type == sf::Event::KeyPressed && (event.key.code == sf::Keyboard::Space ||
+                    event.key.code == sf::Keyboard::Enter || event.key.code == sf::Keyboard::Escape)) {
+                    netLeaveRequested = true;
+                }
+            } else if (!replaying && (currentState == GameState::PlayingSingle || currentState == GameState::PlayingMulti)) {
+                if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F1) botEnabled[0] = !botEnabled[0];
+                for (int p = 0; p < keyboardPlayers; p++) {
+                    if (event.type == sf::Event::KeyPressed) {
+                        if (event.key.code == keyBindings[p].jump) inputTimeline.push(p, ActionJump, timed.micros);
+                        else if (event.key.code == keyBindings[p].fastFall) inputTimeline.push(p, ActionFastFallDown, timed.micros);
+                    } else if (event.type == sf::Event::KeyReleased && event.key.code == keyBindings[p].fastFall) {
+                        inputTimeline.push(p, ActionFastFallUp, timed.micros);
                     }
                 }
             }
-            // else if (currentState == GameState::GameOver) {
-            //     if (event.type == sf::Event::KeyPressed) {
-            //         if (event.key.code == sf::Keyboard::Space) {
-            //             currentState = GameState::StartScreen;
-            //             // Bodies are destroyed on game over, ensure pointers are null
-            //             playerBody = nullptr;
-            //             player2Body = nullptr;
-            //             blocks.clear();
-            //             collectibles.clear();
-            //             collectiblesToRemoveFromWorld.clear();
-            //             contactListener.reset();
-            //             backgroundMusic.stop();
-            //         }
-            //     }
-            // }
         }
+        timedEvents.clear();
+        traceInput.end();
 
-        float dt = deltaClock.restart().asSeconds();
-        if (currentState != GameState::PlayingSingle && currentState != GameState::PlayingMulti) {
-            dt = 0;
-        } else {
-            dt = std::min(dt, 0.1f);
-            gameTime += dt;
+        // A local round out of focus is paused: nothing to step or draw.
+        if (!windowFocused && playing && !netGame && !replaying) {
+            frameClock.restart();
+            continue;
+        }
 
-            // Apply fast fall gravity scale if active and not grounded
-            if (playerBody) {
-                if (fastFallActive && !contactListener.isGrounded(PLAYER1_ID)) {
-                    playerBody->SetGravityScale(fastFallGravityScale);
-                } else {
-                    playerBody->SetGravityScale(1.0f);
-                }
+        if (currentState == GameState::Connecting && netSession->synchronise(netSeed, netClock.getElapsedTime().asSeconds())) {
+            netSession->start();
+            netGame = true;
+            netLeaveRequested = false;
+            keyboardPlayers = 1;
+            for (int p = 1; p < MAX_PLAYERS; p++) botEnabled[p] = false;
+            showLeaderboard = false;
+            currentState = GameState::PlayingMulti;
+            startTicking();
+            backgroundMusic.play();
+        }
+        if (currentState == GameState::GameOver && netGame) {
+            // Keep sending so the other side can confirm the ending as well.
+            float now = netClock.getElapsedTime().asSeconds();
+            netSession->advance(PlayerInput(), now);
+            if (netLeaveRequested && (netSession->peerConfirmedEnding() || now - netRoundEndedAt >= NET_LEAVE_TIMEOUT)) {
+                netSession.reset();
+                netLink.drain();
+                netGame = false;
+                sim.endRound();
+                currentState = GameState::StartScreen;
             }
-            if (player2Body) {
-                if (fastFallActive2 && !contactListener.isGrounded(PLAYER2_ID)) {
-                    player2Body->SetGravityScale(fastFallGravityScale);
+        }
+
+        sf::Int64 simMicros = 0;
+        bool roundEnded = false;
+        if (currentState == GameState::PlayingSingle || currentState == GameState::PlayingMulti) {
+            sf::Clock simClock;
+            TraceScope traceStep("step");
+            sf::Int64 now = inputClock.getElapsedTime().asMicroseconds();
+            tickedUntil = std::max(tickedUntil, now - maxTicksPerFrame * tickMicros);
+            // A replay plays one recorded tick per frame, as fast as frames go.
+            int ticksRun = 0;
+            while (!roundEnded && (replaying ? ticksRun == 0 : tickedUntil + tickMicros <= now)) {
+                sf::Int64 tickEnd = tickedUntil + tickMicros;
+                float dt = NET_TICK;
+                if (replaying) {
+                    const SessionRecording::Tick& tick = replayRecording.ticks[replayTick++];
+                    dt = tick.dt;
+                    for (int p = 0; p < MAX_PLAYERS; p++) inputs[p] = unpackInput(tick.inputs[p]);
                 } else {
-                    player2Body->SetGravityScale(1.0f);
+                    inputTimeline.inputsFor(tickEnd, inputs);
                 }
-            }
-
-            world.Step(dt, 8, 3);
 
-            
-            if (playerBody) playerSprite.setPosition(toPixels(playerBody->GetPosition()));
-            if (player2Body) player2Sprite.setPosition(toPixels(player2Body->GetPosition()));
-
-            
-            for (auto& block : blocks) {
-                if (block.body) {
-                    block.shape.setPosition(toPixels(block.body->GetPosition()));
-                    block.line.setPosition(block.shape.getPosition().x, block.shape.getPosition().y + fixedHeight / 2.f);
-                    if (block.shape.getPosition().x < -block.shape.getSize().x / 2.f) {
-                        block.markedForRemoval = true;
+                // Bots write into the same PlayerInput the keyboard fills, then both are applied alike.
+                // Over the network inputs[0] is always the local player, whichever slot that is.
+                for (int p = 0; p < (netGame ? 1 : sim.playerCount); p++) {
+                    int slot = netGame ? netSession->slot() : p;
+                    if (botEnabled[p] && sim.players[slot].body) {
+                        sim.observe(slot, botObservation);
+                        inputs[p] = bots[p].think(botObservation, botWorld);
                     }
                 }
-            }
 
-            
-            if (currentState == GameState::PlayingSingle) {
-                for (auto& collectible : collectibles) {
-                    if (collectible.body) {
-                        collectible.sprite.setPosition(toPixels(collectible.body->GetPosition()));
-                        if (collectible.sprite.getPosition().x < -collectible.sprite.getGlobalBounds().width / 2.f || collectible.sprite.getPosition().y > windowHeight + collectible.sprite.getGlobalBounds().height / 2.f) {
-                            collectible.markedForRemoval = true;
-                        }
+                if (netGame) {
+                    if (!netSession->advance(inputs[0], netClock.getElapsedTime().asSeconds())) {
+                        // Too far ahead of the other player: wait for their inputs,
+                        // keeping at most one tick owed.
+                        tickedUntil = std::max(tickedUntil, now - tickMicros);
+                        break;
                     }
+                } else {
+                    sim.tick(dt, inputs);
+                    sessionRecorder.record(dt, inputs);
                 }
-            }
-
-
-            
-            if (currentState == GameState::PlayingSingle) {
-                for (b2Body* bodyToRemove : collectiblesToRemoveFromWorld) {
-                    for (auto it = collectibles.begin(); it != collectibles.end(); ++it) {
-                        if (it->body == bodyToRemove) {
-                            switch (it->type) {
-                                case CollectibleType::Magenta: score++; collectSound.play(); break;
-                                case CollectibleType::Orange: score += 3; collectSound.play(); break;
-                                case CollectibleType::Green: currentPlatformEffect = PlatformEffect::Lengthen; platformEffectClock.restart(); collectSound.play(); break;
-                                case CollectibleType::Red: currentPlatformEffect = PlatformEffect::Shorten; platformEffectClock.restart(); collectSound.play(); break;
-                                case CollectibleType::White: isRainingMagenta = true; magentaRainClock.restart(); magentaRainSpawnClock.restart(); collectSound.play(); break;
-                                case CollectibleType::MinusScore: score = std::max(0, score - 2); collectSound.play(); break;
-                            }
-                            it->markedForRemoval = true;
-                            break;
-                        }
-                    }
+                sf::Int64 press = inputTimeline.consume(tickEnd);
+                if (press >= 0 && pressAwaitingPhoton < 0) pressAwaitingPhoton = press;
+                tickedUntil = tickEnd;
+                ticksRun++;
+                stateStream.publish(sim);
+
+                for (CollectibleType pickup : sim.events.pickups) {
+                    int priority = (pickup == CollectibleType::Magenta) ? 0 :
+                                   (pickup == CollectibleType::Orange || pickup == CollectibleType::MinusScore) ? 1 : 2;
+                    soundPool.play(collectBuffer, SoundPickup, priority);
                 }
-                collectiblesToRemoveFromWorld.clear();
-            } else { 
-                 for (b2Body* bodyToRemove : collectiblesToRemoveFromWorld) {
-                     for (auto it = collectibles.begin(); it != collectibles.end(); ++it) {
-                         if (it->body == bodyToRemove) {
-                             it->markedForRemoval = true;
-                             break;
-                         }
-                     }
-                 }
-                 collectiblesToRemoveFromWorld.clear();
+                // Over the network only an ending both sides have confirmed counts.
+                roundEnded = netGame ? netSession->roundFinished() : sim.events.roundEnded;
             }
+            simMicros = simClock.getElapsedTime().asMicroseconds();
+            traceStep.end();
 
+            if (currentState == GameState::PlayingSingle && ghostsEnabled) {
+                const SimPlayer& player = sim.players[0];
+                if (player.body) ghostRecorder.update(sim.gameTime, player.x, player.y, player.grounded);
+            }
 
-            
-            blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [&](Block& block) {
-                if (block.markedForRemoval && block.body) {
-                    world.DestroyBody(block.body);
-                    block.body = nullptr;
-                    return true;
-                }
-                return false;
-            }), blocks.end());
-
-            collectibles.erase(std::remove_if(collectibles.begin(), collectibles.end(), [&](Collectible& collectible) {
-                if (collectible.markedForRemoval && collectible.body) {
-                    world.DestroyBody(collectible.body);
-                    collectible.body = nullptr;
-                    return true;
-                }
-                return false;
-            }), collectibles.end());
-
-
-            
-            if (currentState == GameState::PlayingSingle) {
-                if (playerBody) { 
-                    if (contactListener.isGrounded(PLAYER1_ID)) {
-                        jumpsRemaining = maxJumps;
-                        playerSprite.setTexture(staticPlayerTexture);
-                    } else {
-                        playerSprite.setTexture(jumpPlayerTexture);
-                    }
-
-                    if (fastFallActive && !contactListener.isGrounded(PLAYER1_ID)) {
-                        playerBody->SetGravityScale(fastFallGravityScale);
-                    } else {
-                        playerBody->SetGravityScale(1.0f); 
-                    }
-        
-
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-
-                     
-                    if (contactListener.hasTouchedGround(PLAYER1_ID) || (playerBody && (playerBody->GetPosition().y > toMeters(sf::Vector2f(0, windowHeight + playerHeight)).y || playerBody->GetPosition().x < toMeters(sf::Vector2f(-playerWidth, 0)).x))) {
-                        currentState = GameState::GameOver;
-                        backgroundMusic.stop();
-                        if (score > highScore) {
-                            highScore = score;
-                            saveHighScore("highscore.txt", highScore);
-                        }
-                        
-                        gameOverText.setString("Game Over!");
-                        sf::FloatRect textRect = gameOverText.getLocalBounds();
-                        gameOverText.setOrigin(textRect.left + textRect.width/2.0f, textRect.top + textRect.height/2.0f);
-                        gameOverText.setPosition(sf::Vector2f(windowWidth/2.0f, windowHeight/2.0f - 100.f));
-
-                        
-                        if(playerBody) world.DestroyBody(playerBody);
-                        playerBody = nullptr;
-                    }
-                } 
-            } else if (currentState == GameState::PlayingMulti) {
-                
-                if (player1Alive && playerBody) { 
-                    if (contactListener.isGrounded(PLAYER1_ID)) {
-                        jumpsRemaining = maxJumps;
-                        playerSprite.setTexture(staticPlayerTexture);
-                    } else {
-                        playerSprite.setTexture(jumpPlayerTexture);
-                    }
-
-                    if (fastFallActive && !contactListener.isGrounded(PLAYER1_ID)) {
-                        playerBody->SetGravityScale(fastFallGravityScale);
-                    } else {
-                        playerBody->SetGravityScale(1.0f); 
-                    }
-        
-
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-
-                    
-                    if (contactListener.hasTouchedGround(PLAYER1_ID) || (playerBody && (playerBody->GetPosition().y > toMeters(sf::Vector2f(0, windowHeight + playerHeight)).y || playerBody->GetPosition().x < toMeters(sf::Vector2f(-playerWidth, 0)).x))) {
-                        player1Alive = false;
-                        world.DestroyBody(playerBody);
-                        playerBody = nullptr; 
-                        if (player2Alive) winner = 2; 
-                        else winner = 0; 
-                    }
+            if (roundEnded) {
+                backgroundMusic.stop();
+                if (sessionRecorder.isActive()) {
+                    std::string sessionPath = recordPrefix + std::to_string(++sessionsRecorded) + ".session";
+                    if (saveSession(sessionPath, sessionRecorder.finish(sim))) std::cout << "Recorded " << sessionPath << std::endl;
                 }
-
-                
-                if (player2Alive && player2Body) { 
-                     if (contactListener.isGrounded(PLAYER2_ID)) {
-                        jumpsRemaining2 = maxJumps;
-                        player2Sprite.setTexture(staticPlayer2Texture);
-                    } else {
-                        player2Sprite.setTexture(jumpPlayer2Texture);
+                if (currentState == GameState::PlayingSingle) {
+                    LeaderboardEntry run;
+                    run.score = sim.score;
+                    run.timeSeconds = sim.gameTime;
+                    run.seed = sim.roundSeed;
+                    run.date = static_cast<int64_t>(std::time(nullptr));
+                    int rank = replaying ? 0 : leaderboard.submit(run);
+                    highScore = leaderboard.bestScore();
+                    if (ghostsEnabled) {
+                        ghostRenderer.stop();
+                        ghostRecorder.track.score = sim.score;
+                        ghostLibrary.submit(ghostRecorder.track);
                     }
 
-                    if (fastFallActive2 && !contactListener.isGrounded(PLAYER2_ID)) {
-                        player2Body->SetGravityScale(fastFallGravityScale);
-                    } else {
-                        player2Body->SetGravityScale(1.0f); 
-                    }
-        
-
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-                    
-
-                    
-                    if (contactListener.hasTouchedGround(PLAYER2_ID) || (player2Body && (player2Body->GetPosition().y > toMeters(sf::Vector2f(0, windowHeight + playerHeight)).y || player2Body->GetPosition().x < toMeters(sf::Vector2f(-playerWidth, 0)).x))) {
-                        player2Alive = false;
-                        world.DestroyBody(player2Body);
-                        player2Body = nullptr; 
-                        if (player1Alive) winner = 1; 
-                        else winner = 0; 
+                    std::ostringstream table;
+                    table << (rank > 0 ? "New #" + std::to_string(rank) + "!" : std::string("Top runs")) << "\n";
+                    const std::vector<LeaderboardEntry>& topRuns = leaderboard.entries();
+                    for (size_t i = 0; i < topRuns.size() && i < 5; i++) {
+                        table << (i + 1) << ".  " << topRuns[i].score << "   " << static_cast<int>(topRuns[i].timeSeconds) << "s\n";
                     }
-                }
+                    leaderboardText.setString(table.str());
+                    sf::FloatRect tableRect = leaderboardText.getLocalBounds();
+                    leaderboardText.setOrigin(tableRect.left + tableRect.width/2.0f, 0.f);
+                    leaderboardText.setPosition(windowWidth/2.0f, windowHeight/2.0f - 40.f);
+                    showLeaderboard = true;
 
-                
-                if (!player1Alive || !player2Alive) {
-                    currentState = GameState::GameOver;
-                    backgroundMusic.stop();
-                    
-                    std::string winMessage;
-                    if (winner == 1) winMessage = "Player 1 Wins!";
-                    else if (winner == 2) winMessage = "Player 2 Wins!";
-                    else winMessage = "Tie!"; 
-                    gameOverText.setString(winMessage);
+                    gameOverText.setString("Game Over!");
+                    sf::FloatRect textRect = gameOverText.getLocalBounds();
+                    gameOverText.setOrigin(textRect.left + textRect.width/2.0f, textRect.top + textRect.height/2.0f);
+                    gameOverText.setPosition(sf::Vector2f(windowWidth/2.0f, windowHeight/2.0f - 100.f));
+                } else {
+                    gameOverText.setString(sim.winner > 0 ? "Player " + std::to_string(sim.winner) + " Wins!" : std::string("Tie!"));
                     sf::FloatRect textRect = gameOverText.getLocalBounds();
                     gameOverText.setOrigin(textRect.left + textRect.width/2.0f, textRect.top + textRect.height/2.0f);
                     gameOverText.setPosition(sf::Vector2f(windowWidth/2.0f, windowHeight/3.0f));
                 }
-
-            } 
-
-            
-            if (currentState == GameState::PlayingSingle) {
-                 if (currentPlatformEffect != PlatformEffect::None) {
-                    if (platformEffectClock.getElapsedTime().asSeconds() >= platformEffectDuration) {
-                        currentPlatformEffect = PlatformEffect::None;
-                    }
-                }
-                if (isRainingMagenta) {
-                    if (magentaRainClock.getElapsedTime().asSeconds() >= magentaRainDuration) {
-                        isRainingMagenta = false;
-                    } else {
-                        if (magentaRainSpawnClock.getElapsedTime().asSeconds() >= magentaRainSpawnInterval) {
-                            Collectible rainCollectible;
-                            sf::Vector2f spawnPos(rainXPosDist(gen), -collectibleRadius);
-                            rainCollectible.type = CollectibleType::Magenta;
-                            uintptr_t collectibleUserData = MAGENTA_COLLECTIBLE_ID;
-                            sf::Texture* texturePtr = &collectibleTextures[0];
-                            rainCollectible.sprite.setTexture(*texturePtr);
-                            rainCollectible.sprite.setScale(
-                                (collectibleRadius * 2.f) / rainCollectible.sprite.getTexture()->getSize().x,
-                                (collectibleRadius * 2.f) / rainCollectible.sprite.getTexture()->getSize().y
-                            );
-                            rainCollectible.sprite.setOrigin(rainCollectible.sprite.getTexture()->getSize().x / 2.f, rainCollectible.sprite.getTexture()->getSize().y / 2.f);
-                            rainCollectible.sprite.setPosition(spawnPos);
-                            b2BodyDef collectibleBodyDef;
-                            collectibleBodyDef.type = b2_kinematicBody;
-                            collectibleBodyDef.position = toMeters(spawnPos);
-                            rainCollectible.body = world.CreateBody(&collectibleBodyDef);
-                            b2CircleShape collectibleCircle;
-                            collectibleCircle.m_radius = toMeters(sf::Vector2f(collectibleRadius, 0)).x;
-                            b2FixtureDef collectibleFixtureDef;
-                            collectibleFixtureDef.shape = &collectibleCircle;
-                            collectibleFixtureDef.isSensor = true;
-                            collectibleFixtureDef.userData.pointer = collectibleUserData;
-                            rainCollectible.body->CreateFixture(&collectibleFixtureDef);
-                            rainCollectible.body->SetLinearVelocity(b2Vec2(0.0f, toMeters(sf::Vector2f(0, magentaRainSpeed)).y));
-                            collectibles.push_back(rainCollectible);
-                            magentaRainSpawnClock.restart();
-                        }
-                    }
-                }
+                currentState = GameState::GameOver;
+                // The game-over screen only needs the score and winner. A
+                // network round keeps its world for late rollbacks.
+                if (!netGame && !replaying) sim.endRound();
+                if (netGame) netRoundEndedAt = netClock.getElapsedTime().asSeconds();
             }
 
 
-            
-            float currentMinLength = baseMinLength;
-            float currentMaxLength = baseMaxLength;
-            sf::Color currentBlockColor = defaultBlockColor;
-
-            if (currentState == GameState::PlayingSingle) { 
-                if (currentPlatformEffect == PlatformEffect::Lengthen) {
-                    currentMinLength = baseMinLength * lengthenFactor;
-                    currentMaxLength = baseMaxLength * lengthenFactor;
-                    currentBlockColor = greenBlockColor;
-                } else if (currentPlatformEffect == PlatformEffect::Shorten) {
-                    currentMinLength = baseMinLength * shortenFactor;
-                    currentMaxLength = baseMaxLength * shortenFactor;
-                    currentBlockColor = redBlockColor;
-                }
+            // Each counter rebuilds its digits only when its value changes.
+            if (currentState == GameState::PlayingSingle) {
+                scoreCounter.set(sim.score);
+                highScoreCounter.set(highScore);
             }
+        }
 
 
-            std::uniform_real_distribution<float> currentLengthDist(currentMinLength, currentMaxLength);
-
-            if (spawnClock.getElapsedTime().asSeconds() >= nextSpawnTime) {
-                Block newBlock;
-                float blockLength = currentLengthDist(gen);
-                float spawnY = yPosDist(gen);
-                sf::Vector2f spawnPos(windowWidth + blockLength / 2.f, spawnY);
-
-                newBlock.shape.setSize(sf::Vector2f(blockLength, fixedHeight));
-                newBlock.shape.setFillColor(currentBlockColor);
-                newBlock.shape.setOutlineColor(sf::Color::Black);
-                newBlock.shape.setOutlineThickness(2.5f);
-                newBlock.shape.setOrigin(blockLength / 2.f, fixedHeight / 2.f);
-                newBlock.shape.setPosition(spawnPos);
-
-                newBlock.line.setSize(sf::Vector2f(15.f, 500));
-                newBlock.line.setFillColor(sf::Color(150,150,150));
-                newBlock.line.setOutlineColor(sf::Color::Black);
-                newBlock.line.setOutlineThickness(2.5f);
-                newBlock.line.setOrigin(7.5f, 0.f);
-                newBlock.line.setPosition(spawnPos.x, spawnPos.y + fixedHeight / 2.f);
-
-                b2BodyDef blockBodyDef;
-                blockBodyDef.type = b2_kinematicBody;
-                blockBodyDef.position = toMeters(spawnPos);
-                newBlock.body = world.CreateBody(&blockBodyDef);
-                newBlock.id = nextPlatformId++;
-
-                b2PolygonShape blockBox;
-                blockBox.SetAsBox(toMeters(sf::Vector2f(blockLength / 2.f, fixedHeight / 2.f)).x, toMeters(sf::Vector2f(blockLength / 2.f, fixedHeight / 2.f)).y);
-
-                b2FixtureDef blockFixtureDef;
-                blockFixtureDef.shape = &blockBox;
-                blockFixtureDef.friction = 0.7f;
-                blockFixtureDef.userData.pointer = newBlock.id;
-                newBlock.body->CreateFixture(&blockFixtureDef);
-
-                newBlock.body->SetLinearVelocity(b2Vec2(toMeters(sf::Vector2f(-blockSpeed, 0.f)).x, 0.0f));
-
-                bool visualOverlap = false;
-                sf::FloatRect candidateBounds = newBlock.shape.getGlobalBounds();
-                candidateBounds.left -= 50; 
-                candidateBounds.width += 100; 
-
-                for (const auto& block : blocks) {
-                    if (!block.markedForRemoval && block.body && candidateBounds.intersects(block.shape.getGlobalBounds())) {
-                        visualOverlap = true;
-                        break;
-                    }
-                }
 
-                if (!visualOverlap) {
-                    blocks.push_back(newBlock);
-
-                    
-                    if (currentState == GameState::PlayingSingle) {
-                        float collectibleRoll = collectibleTypeDist(gen);
-                        if (collectibleRoll < collectibleSpawnChance) {
-                            Collectible newCollectible;
-                            sf::Vector2f collectiblePos = spawnPos;
-                            collectiblePos.y -= (fixedHeight / 2.f + collectibleRadius + 5.f); 
-
-                            float typeRoll = collectibleTypeDist(gen);
-                            uintptr_t collectibleUserData = 0;
-                            sf::Texture* texturePtr = nullptr;
-                            CollectibleType type;
-
-                            if (typeRoll < magentaCollectibleProb) {
-                                type = CollectibleType::Magenta;
-                                collectibleUserData = MAGENTA_COLLECTIBLE_ID;
-                                texturePtr = &collectibleTextures[0];
-                            } else if (typeRoll < magentaCollectibleProb + orangeCollectibleProb) {
-                                type = CollectibleType::Orange;
-                                collectibleUserData = ORANGE_COLLECTIBLE_ID;
-                                texturePtr = &collectibleTextures[1];
-                            } else if (typeRoll < magentaCollectibleProb + orangeCollectibleProb + greenCollectibleProb) {
-                                type = CollectibleType::Green;
-                                collectibleUserData = GREEN_COLLECTIBLE_ID;
-                                texturePtr = &collectibleTextures[2];
-                            } else if (typeRoll < magentaCollectibleProb + orangeCollectibleProb + greenCollectibleProb + redCollectibleProb) {
-                                type = CollectibleType::Red;
-                                collectibleUserData = RED_COLLECTIBLE_ID;
-                                texturePtr = &collectibleTextures[3];
-                            } else if (typeRoll < magentaCollectibleProb + orangeCollectibleProb + greenCollectibleProb + redCollectibleProb + whiteCollectibleProb) {
-                                type = CollectibleType::White;
-                                collectibleUserData = WHITE_COLLECTIBLE_ID;
-                                texturePtr = &collectibleTextures[4];
-                            } else {
-                                type = CollectibleType::MinusScore;
-                                collectibleUserData = MINUS_SCORE_COLLECTIBLE_ID;
-                                texturePtr = &collectibleTextures[5];
-                            }
-
-                            newCollectible.type = type;
-                            newCollectible.sprite.setTexture(*texturePtr);
-                            newCollectible.sprite.setScale(
-                                (collectibleRadius * 2.f) / newCollectible.sprite.getTexture()->getSize().x,
-                                (collectibleRadius * 2.f) / newCollectible.sprite.getTexture()->getSize().y
-                            );
-                            newCollectible.sprite.setOrigin(newCollectible.sprite.getTexture()->getSize().x / 2.f, newCollectible.sprite.getTexture()->getSize().y / 2.f);
-                            newCollectible.sprite.setPosition(collectiblePos);
-
-                            b2BodyDef collectibleBodyDef;
-                            collectibleBodyDef.type = b2_kinematicBody;
-                            collectibleBodyDef.position = toMeters(collectiblePos);
-                            newCollectible.body = world.CreateBody(&collectibleBodyDef);
-
-                            b2CircleShape collectibleCircle;
-                            collectibleCircle.m_radius = toMeters(sf::Vector2f(collectibleRadius, 0)).x;
-
-                            b2FixtureDef collectibleFixtureDef;
-                            collectibleFixtureDef.shape = &collectibleCircle;
-                            collectibleFixtureDef.isSensor = true;
-                            collectibleFixtureDef.userData.pointer = collectibleUserData;
-                            newCollectible.body->CreateFixture(&collectibleFixtureDef);
-
-                            
-                            newCollectible.body->SetLinearVelocity(newBlock.body->GetLinearVelocity());
-
-                            collectibles.push_back(newCollectible);
-                        }
-                    } 
-                } else {
-                    
-                    world.DestroyBody(newBlock.body);
-                }
+        // Bodies are drawn between their last two ticks, by how far the clock
+        // is into the next one, so motion stays smooth whatever the refresh
+        // rate. A replay draws each tick as it is.
+        float alpha = 1.f;
+        if (!replaying && (currentState == GameState::PlayingSingle || currentState == GameState::PlayingMulti)) {
+            sf::Int64 sinceTick = inputClock.getElapsedTime().asMicroseconds() - tickedUntil;
+            alpha = std::min(1.f, std::max(0.f, static_cast<float>(sinceTick) / static_cast<float>(tickMicros)));
+        }
+        if (currentState == GameState::PlayingSingle && ghostsEnabled) ghostRenderer.update(sim.gameTime - (1.f - alpha) * NET_TICK);
 
-                spawnClock.restart();
-                std::uniform_real_distribution<float> nextSpawnTimeDist(minSpawnTime, maxSpawnTime);
-                nextSpawnTime = nextSpawnTimeDist(gen);
-            } 
-
-            
-            if (blockSpeed < maxBlockSpeed) {
-                blockSpeed += blockSpeedIncreaseFactor * dt;
-                blockSpeed = std::min(blockSpeed, maxBlockSpeed);
-                
-                float speedRatio = (blockSpeed - 200.f) / (maxBlockSpeed - 200.f);
-                minSpawnTime = lerp(2.5f, minSpawnTimeBase, speedRatio);
-                maxSpawnTime = lerp(3.5f, maxSpawnTimeBase, speedRatio);
-            }
+        TraceScope traceDraw("draw");
+        window.clear(sf::Color(50, 50, 100));
+        drawSprite(backgroundSprite);
 
-            
-            if (currentState == GameState::PlayingSingle) {
-                scoreText.setString("Score \n  " + std::to_string(score));
-                highScoreText.setString("High Score \n    " + std::to_string(highScore));
+        if (currentState == GameState::StartScreen) {
+            drawText(titleText);
+            drawText(singlePlayerText);
+            drawText(multiPlayerText);
+            drawText(versusBotText);
+            if (netConfigured) drawText(networkText);
+        } else if (currentState == GameState::Connecting) {
+            drawText(titleText);
+            drawText(connectingText);
+        } else {
+            {
+                TraceScope traceBatch("world batch");
+                worldBatch.build(sim, alpha);
             }
+            if (worldBatch.drawPlatforms(window)) engineCounters.countDraw(nullptr);
+            if (worldBatch.drawCollectibles(window)) engineCounters.countDraw(&worldBatch.texture());
 
 
-        } 
-
-
-        
-        window.clear(sf::Color(50, 50, 100));
-        window.draw(backgroundSprite);
+            if (currentState == GameState::PlayingSingle && ghostRenderer.draw(window)) {
+                engineCounters.countDraw(&ghostRenderer.texture());
+            }
 
-        if (currentState == GameState::StartScreen) {
-            window.draw(titleText);
-            window.draw(singlePlayerText);
-            window.draw(multiPlayerText);
-        } else { 
-            for (const auto& block : blocks) {
-                window.draw(block.line);
-                window.draw(block.shape);
+            for (int i = 0; i < sim.playerCount; i++) {
+                const SimPlayer& player = sim.players[i];
+                if (!player.body) continue;
+                sf::Sprite& sprite = playerSprites[i];
+                sprite.setTexture(player.grounded ? *playerIdleTextures[i] : *playerJumpTextures[i]);
+                sprite.setPosition(lerp(player.prevX, player.x, alpha), lerp(player.prevY, player.y, alpha));
+                drawSprite(sprite);
             }
 
-            
+
             if (currentState == GameState::PlayingSingle) {
-                for (const auto& collectible : collectibles) {
-                    window.draw(collectible.sprite);
+                for (const HudCounter* counter : { &scoreCounter, &highScoreCounter }) {
+                    drawText(counter->labelText());
+                    if (counter->drawValue(window)) engineCounters.countDraw(&counter->texture());
                 }
+            } else if (currentState == GameState::GameOver) {
+                drawText(gameOverText);
+                if (showLeaderboard) drawText(leaderboardText);
             }
+        }
 
-            
-            if (playerBody) window.draw(playerSprite);
-            if (player2Body) window.draw(player2Sprite); 
 
-            
-            if (currentState == GameState::PlayingSingle) {
-                window.draw(scoreText);
-                window.draw(highScoreText);
-            } else if (currentState == GameState::GameOver) {
-                window.draw(gameOverText);
-                
-                // sf::Text returnText("Press SPACE to return to menu", font, 20);
-                // returnText.setFillColor(sf::Color::White);
-                // sf::FloatRect returnRect = returnText.getLocalBounds();
-                // returnText.setOrigin(returnRect.left + returnRect.width/2.0f, returnRect.top + returnRect.height/2.0f);
-                // returnText.setPosition(sf::Vector2f(windowWidth/2.0f, windowHeight/3.0f + 100.f));
-                // window.draw(returnText);
+        if (pacingWindowClock.getElapsedTime().asSeconds() >= 0.5f) {
+            if (showOverlay) {
+                pacingText.setString(framePacing.hudText());
+                countersText.setString(engineCounters.overlayText());
             }
+            framePacing.endWindow();
+            pacingWindowClock.restart();
+        }
+        if (showOverlay) {
+            drawText(pacingText);
+            drawText(countersText);
         }
 
+        traceDraw.end();
 
-        window.display();
-    } 
+        framePacer.workFinished();
+        sf::Clock presentClock;
+        {
+            TraceScope traceDisplay("display");
+            window.display();
+        }
+        framePacer.frameShown();
+        // Input to photon, as near as we can see it: from the key press to
+        // display() returning with the first frame that reflects it.
+        if (pressAwaitingPhoton >= 0) {
+            framePacing.recordInputLatency(inputClock.getElapsedTime().asMicroseconds() - pressAwaitingPhoton);
+            pressAwaitingPhoton = -1;
+        }
+        engineCounters.endFrame(sim);
+        if (Tracer::enabled()) {
+            const FrameCounters& counters = engineCounters.last();
+            Tracer::instance().counter("bodies", counters.bodies);
+            Tracer::instance().counter("contacts", counters.contacts);
+            Tracer::instance().counter("platforms", counters.platforms);
+            Tracer::instance().counter("collectibles", counters.collectibles);
+            Tracer::instance().counter("draw calls", counters.drawCalls);
+        }
+        if (countersLogSeconds > 0.f && countersLogClock.getElapsedTime().asSeconds() >= countersLogSeconds) {
+            std::cout << engineCounters.logLine() << std::endl;
+            countersLogClock.restart();
+        }
+        sf::Int64 frameMicros = frameClock.restart().asMicroseconds();
+        // Idle frames are spaced by waiting, not pacing; they would swamp the stats.
+        if (!idle) framePacing.recordFrame(frameMicros, simMicros, presentClock.getElapsedTime().asMicroseconds());
+        if (replaying) {
+            replayFrameTimes.record(frameMicros);
+            if (replayTick >= replayRecording.ticks.size() || currentState == GameState::GameOver) break;
+        }
+    }
 
-    
-    if (playerBody) world.DestroyBody(playerBody);
-    if (player2Body) world.DestroyBody(player2Body);
-    
+    std::cout << framePacing.summary() << std::endl;
+    if (replaying) {
+        bool matched = replayTick == replayRecording.ticks.size() && sim.score == replayRecording.finalScore &&
+                       sim.stateChecksum() == replayRecording.finalChecksum;
+        double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        std::cout << "Replay " << (matched ? "matches" : "DIVERGED") << ": frames " << replayFrameTimes.count()
+                  << " wall_s " << sessionClock.getElapsedTime().asSeconds() << " cpu_s " << cpuSeconds
+                  << " p50_ms " << replayFrameTimes.percentile(50) / 1000.0 << " p95_ms " << replayFrameTimes.percentile(95) / 1000.0
+                  << " p99_ms " << replayFrameTimes.percentile(99) / 1000.0 << " max_ms " << replayFrameTimes.max() / 1000.0 << std::endl;
+    }
+    if (countersLogSeconds > 0.f) std::cout << AllocationTracker::report() << std::endl;
+    Tracer::instance().stop();
 
+    if (stateStream.isOpen()) {
+        std::cout << "State stream: " << stateStream.recordsPublished() << " records, "
+                  << stateStream.recordsDropped() << " dropped" << std::endl;
+    }
     return 0;
 }
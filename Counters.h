@@ -0,0 +1,294 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#include "GameSim.h"
+
+struct AllocationStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// Counts operator new calls and bytes: in total, per thread and per phase,
+// a phase being the innermost TraceScope open on the allocating thread.
+//
+// Counting is opt-in: build with -DRAT_RIDER_COUNT_ALLOCATIONS (AllocationCheck
+// defines it itself) and this header replaces every form of the global
+// operator new and delete, aligned and nothrow included. Without it nothing
+// is replaced, enabled is false and every count stays zero. Each program
+// here is a single translation unit, which is what the replacements need.
+//
+// Box2D is not counted. Its b2Alloc can only be redirected by building the
+// library itself with B2_USER_SETTINGS and a b2_user_settings.h, and the
+// game links the prebuilt library, so Box2D's blocks go straight to malloc.
+// EngineCounters' body and contact counts are what shows its growth.
+class AllocationTracker {
+public:
+    static const int MAX_PHASES = 32;
+#ifdef RAT_RIDER_COUNT_ALLOCATIONS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    static void record(size_t bytes) noexcept {
+        Phase& all = totalSlot();
+        all.count.fetch_add(1, std::memory_order_relaxed);
+        all.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        AllocationStats& mine = threadStats();
+        mine.count++;
+        mine.bytes += bytes;
+        Phase& phase = phaseSlot(currentTracePhase());
+        phase.count.fetch_add(1, std::memory_order_relaxed);
+        phase.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    static AllocationStats total() { return read(totalSlot()); }
+
+    // The calling thread's allocations so far; frames diff two readings.
+    static AllocationStats thread() { return threadStats(); }
+
+    // Phases in the order they first allocated. Allocations outside any
+    // TraceScope are listed under "(no phase)".
+    static int phaseCount() {
+        int count = 0;
+        while (count < MAX_PHASES && phases()[count].name.load(std::memory_order_acquire)) count++;
+        return count;
+    }
+    static const char* phaseName(int index) { return phases()[index].name.load(std::memory_order_acquire); }
+    static AllocationStats phase(int index) { return read(phases()[index]); }
+
+    // One line per phase that has allocated, e.g. for a report on exit.
+    static std::string report() {
+        if (!enabled) return "Allocations: not counted in this build";
+        std::ostringstream out;
+        AllocationStats all = total();
+        out << "Allocations: " << all.count << " (" << all.bytes << " bytes)";
+        for (int i = 0; i < phaseCount(); i++) {
+            AllocationStats stats = phase(i);
+            out << "\n  " << phaseName(i) << ": " << stats.count << " (" << stats.bytes << " bytes)";
+        }
+        return out.str();
+    }
+
+private:
+    struct Phase {
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> bytes;
+    };
+
+    // Function statics with trivial constructors: zero-initialised before
+    // anything runs, so they are safe to use from operator new itself.
+    static Phase* phases() {
+        static Phase table[MAX_PHASES];
+        return table;
+    }
+
+    static Phase& totalSlot() {
+        static Phase all;
+        return all;
+    }
+
+    static AllocationStats& threadStats() {
+        thread_local AllocationStats stats;
+        return stats;
+    }
+
+    // Names are compared by pointer, which is enough for string literals.
+    // When the table is full the rest share the last slot.
+    static Phase& phaseSlot(const char* name) {
+        if (!name) name = "(no phase)";
+        Phase* table = phases();
+        for (int i = 0; i < MAX_PHASES - 1; i++) {
+            const char* slotName = table[i].name.load(std::memory_order_acquire);
+            if (slotName == name) return table[i];
+            if (!slotName) {
+                const char* expected = nullptr;
+                if (table[i].name.compare_exchange_strong(expected, name, std::memory_order_acq_rel) || expected == name) {
+                    return table[i];
+                }
+            }
+        }
+        const char* expected = nullptr;
+        table[MAX_PHASES - 1].name.compare_exchange_strong(expected, "(other phases)", std::memory_order_acq_rel);
+        return table[MAX_PHASES - 1];
+    }
+
+    static AllocationStats read(const Phase& phase) {
+        AllocationStats stats;
+        stats.count = phase.count.load(std::memory_order_relaxed);
+        stats.bytes = phase.bytes.load(std::memory_order_relaxed);
+        return stats;
+    }
+};
+
+#ifdef RAT_RIDER_COUNT_ALLOCATIONS
+namespace allocation_detail {
+
+inline void* allocate(std::size_t size) noexcept {
+    AllocationTracker::record(size);
+    return std::malloc(size ? size : 1);
+}
+
+// Over-aligned types (alignas beyond max_align_t) come through here.
+inline void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept {
+    AllocationTracker::record(size);
+    std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc wants the size to be a multiple of the alignment.
+    return std::aligned_alloc(align, ((size ? size : 1) + align - 1) & ~(align - 1));
+#endif
+}
+
+inline void freeAligned(void* memory) noexcept {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+}
+
+void* operator new(std::size_t size) {
+    if (void* memory = allocation_detail::allocate(size)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocation_detail::allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocation_detail::allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* memory = allocation_detail::allocateAligned(size, alignment)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocation_detail::allocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocation_detail::allocateAligned(size, alignment);
+}
+// Out of line so GCC does not see new paired with free and warn about it.
+#if defined(__GNUC__)
+#define RAT_RIDER_NOINLINE __attribute__((noinline))
+#else
+#define RAT_RIDER_NOINLINE
+#endif
+RAT_RIDER_NOINLINE void operator delete(void* memory) noexcept { std::free(memory); }
+RAT_RIDER_NOINLINE void operator delete[](void* memory) noexcept { std::free(memory); }
+RAT_RIDER_NOINLINE void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+RAT_RIDER_NOINLINE void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+RAT_RIDER_NOINLINE void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+RAT_RIDER_NOINLINE void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+RAT_RIDER_NOINLINE void operator delete(void* memory, std::align_val_t) noexcept { allocation_detail::freeAligned(memory); }
+RAT_RIDER_NOINLINE void operator delete[](void* memory, std::align_val_t) noexcept { allocation_detail::freeAligned(memory); }
+RAT_RIDER_NOINLINE void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    allocation_detail::freeAligned(memory);
+}
+RAT_RIDER_NOINLINE void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    allocation_detail::freeAligned(memory);
+}
+RAT_RIDER_NOINLINE void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+    allocation_detail::freeAligned(memory);
+}
+RAT_RIDER_NOINLINE void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+    allocation_detail::freeAligned(memory);
+}
+#endif
+
+// What the engine held and did during one frame.
+struct FrameCounters {
+    int bodies = 0;                 // b2World::GetBodyCount()
+    int contacts = 0;               // b2World::GetContactCount()
+    int proxies = 0;                // broad-phase proxies
+    int platforms = 0;
+    int collectibles = 0;
+    int collectiblesToRemove = 0;   // pickups queued by the contact listener and not yet handled
+    int drawCalls = 0;              // window.draw calls
+    int textureSwitches = 0;        // draws whose texture differs from the previous draw's
+    uint64_t allocations = 0;       // operator new calls on the frame's thread
+    uint64_t allocatedBytes = 0;
+};
+
+// Per-frame engine counters. The frontend calls beginFrame(), reports each
+// draw, then endFrame() once the frame is shown; last() is the most recent
+// complete frame. Slow leaks, such as bodies surviving a round, show up as
+// counts that only ever grow.
+class EngineCounters {
+public:
+    void beginFrame() {
+        current = FrameCounters();
+        lastTexture = nullptr;
+        firstDraw = true;
+        allocationsAtStart = AllocationTracker::thread();
+    }
+
+    // texture identifies what the draw binds; nullptr for untextured shapes.
+    void countDraw(const void* texture) {
+        current.drawCalls++;
+        if (!firstDraw && texture != lastTexture) current.textureSwitches++;
+        lastTexture = texture;
+        firstDraw = false;
+    }
+
+    void endFrame(const GameSim& sim) {
+        current.bodies = sim.world->GetBodyCount();
+        current.contacts = sim.world->GetContactCount();
+        current.proxies = sim.world->GetProxyCount();
+        current.platforms = static_cast<int>(sim.platforms.size());
+        current.collectibles = static_cast<int>(sim.collectibles.size());
+        current.collectiblesToRemove = static_cast<int>(sim.collectiblesToRemove.size());
+        AllocationStats allocated = AllocationTracker::thread();
+        current.allocations = allocated.count - allocationsAtStart.count;
+        current.allocatedBytes = allocated.bytes - allocationsAtStart.bytes;
+        completed = current;
+        frames++;
+    }
+
+    const FrameCounters& last() const { return completed; }
+    uint64_t framesCounted() const { return frames; }
+
+    std::string overlayText() const {
+        std::ostringstream out;
+        out << "bodies " << completed.bodies << "  contacts " << completed.contacts << "  proxies " << completed.proxies << "\n"
+            << "platforms " << completed.platforms << "  collectibles " << completed.collectibles
+            << "  to remove " << completed.collectiblesToRemove << "\n"
+            << "draws " << completed.drawCalls << "  texture switches " << completed.textureSwitches << "\n"
+            << allocationText();
+        return out.str();
+    }
+
+    // One line for the periodic log.
+    std::string logLine() const {
+        std::ostringstream out;
+        out << "frame " << frames << ": bodies " << completed.bodies << ", contacts " << completed.contacts
+            << ", proxies " << completed.proxies << ", platforms " << completed.platforms
+            << ", collectibles " << completed.collectibles << ", to remove " << completed.collectiblesToRemove
+            << ", draws " << completed.drawCalls << ", texture switches " << completed.textureSwitches
+            << ", " << allocationText();
+        return out.str();
+    }
+
+private:
+    std::string allocationText() const {
+        if (!AllocationTracker::enabled) return "allocations not counted";
+        return "allocations " + std::to_string(completed.allocations) + " (" + std::to_string(completed.allocatedBytes) + " bytes)";
+    }
+
+    FrameCounters current;
+    FrameCounters completed;
+    const void* lastTexture = nullptr;
+    bool firstDraw = true;
+    AllocationStats allocationsAtStart;
+    uint64_t frames = 0;
+};
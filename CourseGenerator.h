@@ -0,0 +1,277 @@
+#pragma once
+
+#include "Tunables.h"
+#include "JumpEnvelope.h"
+#include "Trace.h"
+#include <vector>
+#include <deque>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+
+// One precomputed platform spawn. Length is stored as a fraction of the
+// current length range so platform effects picked up later still apply.
+struct PlatformSpec {
+    float lengthT = 0.5f;       // 0 = current min length, 1 = current max length
+    float spawnY = 0.f;         // platform centre, pixels
+    float delay = 0.f;          // seconds after the previous spawn
+    bool hasCollectible = false;
+    float collectibleTypeRoll = 0.f;
+};
+
+// Everything the generator needs to predict the course, copied in on restart.
+struct CourseParams {
+    Tunables tun;
+    float windowWidth = 1200.f;
+    float windowHeight = 700.f;
+    float pixelsPerMeter = 50.f;
+    float playerX = 300.f;
+    // Platform already in the world that the first generated one must be reachable from.
+    bool hasPreviousPlatform = false;
+    float previousRightEdge = 0.f;
+    float previousY = 0.f;
+    float firstDelay = 0.f;     // wait before the first generated spawn
+};
+
+
+// Produces platforms ahead of time on a background thread. The generator
+// replays the block speed ramp from the round clock, so it knows the speed
+// each platform spawns with and how far apart consecutive platforms will be.
+// Candidates are drawn in batches and checked against the jump envelope and
+// the overlap margin; anything the player could not reach from the previous
+// platform, or that would spawn on top of it, is dropped before it is
+// queued. Every queued spec is spawned as is. The game thread only pops
+// finished specs.
+class CourseGenerator {
+public:
+    static constexpr size_t CHUNK_SIZE = 16;
+    static constexpr size_t QUEUE_TARGET = 64;
+    static constexpr size_t CANDIDATE_BATCH = 8;
+    static constexpr int MAX_BATCHES = 4;
+
+    struct GeneratorState {
+        std::mt19937 rng;
+        float time = 0.f;           // round clock at the last accepted spawn
+        float pendingDelay = 0.f;   // wait from the last accepted spawn to the next candidate
+        bool hasPrevious = false;
+        float previousTrail = 0.f;  // how far the previous platform reaches past the spawn line at `time`
+        float previousReach = 0.f;  // the same if an effect makes it as long as it can be
+        float previousLength = 0.f;
+        float previousY = 0.f;
+    };
+
+    // Everything next() depends on, so a simulation can be rewound.
+    struct Snapshot {
+        CourseParams params;
+        GeneratorState state;
+        std::vector<PlatformSpec> queue;    // a vector, so repeated saves reuse its storage
+        bool started = false;
+    };
+
+    // Without a background thread every spec is generated inline by next();
+    // used when many simulations run side by side.
+    explicit CourseGenerator(bool background = true) {
+        if (background) worker = std::thread(&CourseGenerator::workerLoop, this);
+    }
+
+    ~CourseGenerator() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopWorker = true;
+        }
+        wake.notify_one();
+        if (worker.joinable()) worker.join();
+    }
+
+    CourseGenerator(const CourseGenerator&) = delete;
+    CourseGenerator& operator=(const CourseGenerator&) = delete;
+
+    // Drops anything queued and starts a new course at startTime seconds into the round.
+    void restart(const CourseParams& newParams, uint32_t seed, float startTime = 0.f) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            params = newParams;
+            // Reseed in place: constructing a fresh mt19937 would seed it twice.
+            state.rng.seed(seed);
+            state.time = startTime;
+            state.pendingDelay = newParams.firstDelay;
+            state.hasPrevious = newParams.hasPreviousPlatform;
+            state.previousTrail = newParams.previousRightEdge - newParams.windowWidth;
+            state.previousReach = state.previousTrail;
+            state.previousLength = std::max(0.f, newParams.previousRightEdge - newParams.playerX);
+            state.previousY = newParams.previousY;
+            queue.clear();
+            started = true;
+            stateVersion++;
+        }
+        wake.notify_one();
+    }
+
+    // Pops the next platform. Only generates inline if the worker has fallen behind.
+    PlatformSpec next() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queue.empty()) {
+            generateOne(params, state, queue);
+            stateVersion++;
+            fallbackCount++;
+        }
+        PlatformSpec spec = queue.front();
+        queue.pop_front();
+        lock.unlock();
+        wake.notify_one();
+        return spec;
+    }
+
+    void save(Snapshot& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        out.params = params;
+        out.state = state;
+        out.queue.assign(queue.begin(), queue.end());
+        out.started = started;
+    }
+
+    void load(const Snapshot& in) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            params = in.params;
+            state = in.state;
+            queue.assign(in.queue.begin(), in.queue.end());
+            started = in.started;
+            stateVersion++;
+        }
+        wake.notify_one();
+    }
+
+    size_t queued() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queue.size();
+    }
+
+    // Number of specs the game thread had to generate itself (every spec when
+    // there is no background thread).
+    uint64_t fallbacks() const { return fallbackCount; }
+
+private:
+
+    static float blockSpeedAt(const Tunables& tun, float time) {
+        return std::min(tun.startBlockSpeed + tun.blockSpeedIncreaseFactor * time, tun.maxBlockSpeed);
+    }
+
+    static void spawnWindowAt(const Tunables& tun, float time, float& minTime, float& maxTime) {
+        float speedRatio = (blockSpeedAt(tun, time) - tun.startBlockSpeed) / (tun.maxBlockSpeed - tun.startBlockSpeed);
+        minTime = tun.startMinSpawnTime + speedRatio * (tun.minSpawnTimeBase - tun.startMinSpawnTime);
+        maxTime = tun.startMaxSpawnTime + speedRatio * (tun.maxSpawnTimeBase - tun.startMaxSpawnTime);
+    }
+
+    static void generateOne(const CourseParams& p, GeneratorState& s, std::deque<PlatformSpec>& out) {
+        const Tunables& tun = p.tun;
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        std::uniform_real_distribution<float> yDist(p.windowHeight - tun.platformMinYOffset, p.windowHeight - tun.platformMaxYOffset);
+        // Assume platforms end up as short as an effect can make them, so gaps are never underestimated,
+        // and as long as one can make them, so overlaps are never missed.
+        float shortest = std::min(1.f, tun.shortenFactor);
+        float longest = std::max(1.f, tun.lengthenFactor);
+
+        float lengthT[CANDIDATE_BATCH], spawnY[CANDIDATE_BATCH];
+        float gap[CANDIDATE_BATCH], rise[CANDIDATE_BATCH], targetLength[CANDIDATE_BATCH];
+        uint8_t reachable[CANDIDATE_BATCH];
+
+        PlatformSpec spec;
+        int chosen = -1;
+        for (int batch = 0; batch < MAX_BATCHES && chosen < 0; batch++) {
+            float spawnTime = s.time + s.pendingDelay;
+            // Platforms keep the speed they spawned with.
+            float batchGap = blockSpeedAt(tun, s.time) * s.pendingDelay - s.previousTrail;
+            float closestGap = blockSpeedAt(tun, s.time) * s.pendingDelay - s.previousReach;
+            for (size_t i = 0; i < CANDIDATE_BATCH; i++) {
+                lengthT[i] = unit(s.rng);
+                spawnY[i] = yDist(s.rng);
+                gap[i] = batchGap;
+                rise[i] = s.previousY - spawnY[i];
+                targetLength[i] = (tun.baseMinLength + lengthT[i] * (tun.baseMaxLength - tun.baseMinLength)) * shortest;
+            }
+            if (!s.hasPrevious) {
+                chosen = 0;
+                break;
+            }
+            JumpEnvelope envelope = computeJumpEnvelope(makeJumpParams(tun, p.pixelsPerMeter, blockSpeedAt(tun, spawnTime)), s.previousY);
+            evaluateReachability(envelope, s.previousLength, gap, rise, targetLength, reachable, CANDIDATE_BATCH);
+            for (size_t i = 0; i < CANDIDATE_BATCH && chosen < 0; i++) {
+                bool overlaps = closestGap < tun.platformOverlapMargin && std::fabs(rise[i]) < tun.fixedHeight;
+                if (reachable[i] && !overlaps) chosen = static_cast<int>(i);
+            }
+            // Nothing in this batch works: the gap itself is the problem, so pull the spawn in.
+            if (chosen < 0) s.pendingDelay *= 0.75f;
+        }
+        if (chosen >= 0) {
+            spec.lengthT = lengthT[chosen];
+            spec.spawnY = spawnY[chosen];
+        } else {
+            // Same height as the previous platform, just clear of the overlap margin: always reachable.
+            spec.lengthT = lengthT[0];
+            spec.spawnY = s.previousY;
+            float speed = blockSpeedAt(tun, s.time);
+            s.pendingDelay = std::max(0.f, s.previousReach + tun.platformOverlapMargin) / std::max(speed, 1.f);
+        }
+
+        spec.delay = s.pendingDelay;
+        s.time += s.pendingDelay;
+        s.hasPrevious = true;
+        float baseLength = tun.baseMinLength + spec.lengthT * (tun.baseMaxLength - tun.baseMinLength);
+        s.previousLength = baseLength * shortest;
+        s.previousTrail = s.previousLength;
+        s.previousReach = baseLength * longest;
+        s.previousY = spec.spawnY;
+
+        spec.hasCollectible = unit(s.rng) < tun.collectibleSpawnChance;
+        spec.collectibleTypeRoll = unit(s.rng);
+
+        float minTime, maxTime;
+        spawnWindowAt(tun, s.time, minTime, maxTime);
+        s.pendingDelay = std::uniform_real_distribution<float>(minTime, maxTime)(s.rng);
+        out.push_back(spec);
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopWorker || (started && queue.size() < QUEUE_TARGET); });
+            if (stopWorker) break;
+
+            // Generate a chunk outside the lock from a private copy of the state.
+            uint64_t chunkVersion = stateVersion;
+            CourseParams chunkParams = params;
+            GeneratorState chunkState = state;
+            lock.unlock();
+            std::deque<PlatformSpec> chunk;
+            {
+                TraceScope traceGenerate("generate course");
+                for (size_t i = 0; i < CHUNK_SIZE; i++) generateOne(chunkParams, chunkState, chunk);
+            }
+            lock.lock();
+
+            // Discard the chunk if a restart or an inline fallback moved the state on meanwhile.
+            if (chunkVersion == stateVersion) {
+                queue.insert(queue.end(), chunk.begin(), chunk.end());
+                state = chunkState;
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    CourseParams params;
+    GeneratorState state;
+    std::deque<PlatformSpec> queue;
+    uint64_t stateVersion = 0;  // bumped whenever the game thread changes the state
+    std::atomic<uint64_t> fallbackCount{0};
+    bool started = false;
+    bool stopWorker = false;
+    std::thread worker;
+};
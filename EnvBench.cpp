@@ -0,0 +1,55 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include "RatRiderEnv.h"
+
+// Headless throughput check for RatRiderEnv: steps a batch of environments
+// with random actions and reports env-steps per second.
+//
+// Usage: EnvBench [numEnvs] [threads] [steps]
+int main(int argc, char** argv) {
+    EnvConfig config;
+    config.tun = loadTunables("tunables.cfg");
+    config.numEnvs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    config.threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+    int steps = argc > 3 ? std::atoi(argv[3]) : 10000;
+
+    RatRiderEnv env(config);
+    size_t obsSize = env.observationSize();
+    std::vector<float> observations(env.numEnvs() * obsSize);
+    std::vector<float> rewards(env.numEnvs());
+    std::vector<uint8_t> dones(env.numEnvs());
+    std::vector<uint8_t> actions(env.numEnvs());
+
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<int> actionDist(0, 15);
+    env.reset(1, observations.data());
+
+    long long episodes = 0;
+    double totalReward = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++) {
+        // Jump rarely and fast-fall sometimes, so episodes last a while.
+        for (uint8_t& action : actions) {
+            int roll = actionDist(gen);
+            action = static_cast<uint8_t>((roll == 0 ? InputJump : 0) | (roll >= 13 ? InputFastFall : 0));
+        }
+        env.step(actions.data(), observations.data(), rewards.data(), dones.data());
+        for (size_t i = 0; i < env.numEnvs(); i++) {
+            totalReward += rewards[i];
+            if (dones[i]) episodes++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double envSteps = static_cast<double>(steps) * env.numEnvs();
+    std::cout << env.numEnvs() << " envs, " << steps << " steps, observation " << obsSize << " floats\n";
+    std::cout << "env-steps/sec: " << static_cast<long long>(envSteps / seconds)
+              << " (" << static_cast<long long>(envSteps / seconds / env.threadCount()) << " per thread, "
+              << env.threadCount() << " threads)\n";
+    std::cout << "episodes: " << episodes << ", mean reward/step: " << totalReward / envSteps << std::endl;
+    return 0;
+}
@@ -0,0 +1,274 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <thread>
+
+// Histogram of durations in microseconds with bounded relative error, in
+// the style of HdrHistogram: values below 256 us get a bucket each, above
+// that every power of two is split into 128 buckets, so any reported value
+// is within 1% of the one recorded. Values up to about 71 minutes fit;
+// recording never allocates.
+class FrameTimeHistogram {
+public:
+    FrameTimeHistogram() : counts(BUCKETS, 0) {}
+
+    void record(int64_t micros) {
+        uint64_t value = static_cast<uint64_t>(std::max<int64_t>(micros, 0));
+        value = std::min<uint64_t>(value, 0xFFFFFFFFu);
+        counts[bucketOf(value)]++;
+        total++;
+        maxValue = std::max(maxValue, value);
+    }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0u);
+        total = 0;
+        maxValue = 0;
+    }
+
+    void merge(const FrameTimeHistogram& other) {
+        for (size_t i = 0; i < counts.size(); i++) counts[i] += other.counts[i];
+        total += other.total;
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return maxValue; }
+
+    // Smallest recorded value that at least `percent` of the samples are at
+    // or below, rounded up to its bucket.
+    uint64_t percentile(double percent) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(percent / 100.0 * static_cast<double>(total) + 0.999999);
+        rank = std::min<uint64_t>(std::max<uint64_t>(rank, 1), total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(highestInBucket(i), maxValue);
+        }
+        return maxValue;
+    }
+
+private:
+    static const int SUB_BITS = 8;
+    static const uint64_t LINEAR = 1u << SUB_BITS;          // exact below this
+    static const uint64_t HALF = LINEAR / 2;                // buckets per octave above it
+    static const size_t BUCKETS = LINEAR + (32 - SUB_BITS) * HALF;
+
+    static size_t bucketOf(uint64_t value) {
+        if (value < LINEAR) return static_cast<size_t>(value);
+        int shift = 0;
+        while ((value >> shift) >= LINEAR) shift++;
+        return static_cast<size_t>(LINEAR + (shift - 1) * HALF + ((value >> shift) - HALF));
+    }
+
+    static uint64_t highestInBucket(size_t bucket) {
+        if (bucket < LINEAR) return bucket;
+        int shift = static_cast<int>((bucket - LINEAR) / HALF) + 1;
+        uint64_t sub = (bucket - LINEAR) % HALF + HALF;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<uint32_t> counts;
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+};
+
+// Frame pacing statistics: whole-frame interval, simulation time and
+// present (display) time per frame, input-to-photon latency, plus frames
+// that took long enough to miss a vsync. Keeps a recent window for the HUD
+// and the whole session for the summary printed on exit.
+class FramePacingMonitor {
+public:
+    explicit FramePacingMonitor(float targetHz = 60.f)
+        : targetMicros(static_cast<int64_t>(1000000.0 / targetHz)) {}
+
+    // Once per frame, after display(). A frame counts as a missed vsync when
+    // it ran half an interval or more past its target.
+    void recordFrame(int64_t frameMicros, int64_t simMicros, int64_t presentMicros) {
+        recent[Frame].record(frameMicros);
+        recent[Sim].record(simMicros);
+        recent[Present].record(presentMicros);
+        if (frameMicros * 2 >= targetMicros * 3) recentMissed++;
+    }
+
+    // Time from a key press to the display() that first showed its effect.
+    void recordInputLatency(int64_t micros) {
+        recent[Input].record(micros);
+    }
+
+    // Folds the recent window into the session totals and starts a new one.
+    void endWindow() {
+        for (int i = 0; i < SeriesCount; i++) {
+            session[i].merge(recent[i]);
+            recent[i].reset();
+        }
+        sessionMissed += recentMissed;
+        recentMissed = 0;
+    }
+
+    // The recent window, for the overlay: call before endWindow().
+    std::string hudText() const {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1);
+        const char* names[SeriesCount] = { "frame", "sim", "present", "input" };
+        out << "ms       p50   p95   p99   max\n";
+        for (int i = 0; i < SeriesCount; i++) describe(out, names[i], recent[i]);
+        out << "missed vsync " << recentMissed << " of " << recent[Frame].count();
+        return out.str();
+    }
+
+    std::string summary() const {
+        FrameTimeHistogram all[SeriesCount];
+        for (int i = 0; i < SeriesCount; i++) {
+            all[i].merge(session[i]);
+            all[i].merge(recent[i]);
+        }
+        uint64_t missed = sessionMissed + recentMissed;
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2);
+        out << "Frame pacing over " << all[Frame].count() << " frames (target " << targetMicros / 1000.0 << " ms)\n";
+        out << "ms       p50   p95   p99   max\n";
+        const char* names[SeriesCount] = { "frame", "sim", "present", "input" };
+        for (int i = 0; i < SeriesCount; i++) describe(out, names[i], all[i]);
+        out << "missed vsync " << missed << " ("
+            << (all[Frame].count() ? 100.0 * static_cast<double>(missed) / static_cast<double>(all[Frame].count()) : 0.0) << "%)";
+        return out.str();
+    }
+
+private:
+    enum Series { Frame, Sim, Present, Input, SeriesCount };
+
+    static void describe(std::ostringstream& out, const char* name, const FrameTimeHistogram& histogram) {
+        out << std::left << std::setw(8) << name << std::right;
+        const double percents[3] = { 50.0, 95.0, 99.0 };
+        for (double percent : percents) out << std::setw(6) << histogram.percentile(percent) / 1000.0;
+        out << std::setw(6) << histogram.max() / 1000.0 << "\n";
+    }
+
+    int64_t targetMicros;
+    FrameTimeHistogram recent[SeriesCount];
+    FrameTimeHistogram session[SeriesCount];
+    uint64_t recentMissed = 0;
+    uint64_t sessionMissed = 0;
+};
+
+
+enum class PacingMode { Limited, VSync, Uncapped };
+
+inline const char* pacingModeName(PacingMode mode) {
+    switch (mode) {
+        case PacingMode::Limited: return "limited";
+        case PacingMode::VSync: return "vsync";
+        case PacingMode::Uncapped: return "uncapped";
+    }
+    return "";
+}
+
+// Decides when each frame starts. The loop calls waitForFrame() first,
+// workStarted() once it is done waiting, workFinished() just before
+// display() and frameShown() right after it.
+//  - Limited: a fixed period, hit to well under a millisecond. The pacer
+//    sleeps in 1 ms pieces while more than a 1 ms sleep is likely to take
+//    remains (recent mean plus two deviations), then spins. Deadlines
+//    advance by whole periods, so one late frame does not shift the ones
+//    after it.
+//  - VSync: display() waits for the flip. The pacer then waits until the
+//    next flip is only a frame's work away (the longest recent work plus a
+//    millisecond), so input is read as late as possible.
+//  - Uncapped: no waiting; the frontend interpolates between ticks.
+// poll() is called between sleeps so input keeps being read.
+class FramePacer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    FramePacer(PacingMode mode, double hz)
+        : mode(effectiveMode(mode)),
+          period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz))) {}
+
+    PacingMode pacingMode() const { return mode; }
+    void setMode(PacingMode newMode) {
+        mode = effectiveMode(newMode);
+        deadline = Clock::time_point();
+    }
+
+    template <class Poll>
+    void waitForFrame(Poll&& poll) {
+        Clock::time_point target;
+        if (mode == PacingMode::Limited) {
+            Clock::time_point now = Clock::now();
+            if (deadline == Clock::time_point() || now - deadline > period) deadline = now;
+            target = deadline;
+            deadline += period;
+        } else if (mode == PacingMode::VSync && lastShown != Clock::time_point()) {
+            target = lastShown + period - workBudget - std::chrono::microseconds(1000);
+        } else {
+            return;
+        }
+        waitUntil(target, poll);
+    }
+
+    void workStarted() { workStart = Clock::now(); }
+
+    void workFinished() {
+        // Longest recent work, decaying slowly so one slow frame is not
+        // budgeted for forever.
+        Clock::duration work = Clock::now() - workStart;
+        workBudget = std::max(work, workBudget - workBudget / 64);
+    }
+
+    void frameShown() { lastShown = Clock::now(); }
+
+    // What a 1 ms sleep is allowed for, which decides when to start spinning.
+    int64_t sleepCostMicros() const { return static_cast<int64_t>(sleepCost() * 1e6); }
+
+private:
+    // RevisionShim.h makes the window ignore frame limits so the bench sees
+    // each frame's real cost; the pacer waits on the real clock, so it has to
+    // stand down as well.
+    static PacingMode effectiveMode(PacingMode requested) {
+#ifdef RAT_RIDER_REVISION_SHIM
+        (void)requested;
+        return PacingMode::Uncapped;
+#else
+        return requested;
+#endif
+    }
+
+    template <class Poll>
+    void waitUntil(Clock::time_point target, Poll&& poll) {
+        while (true) {
+            Clock::time_point now = Clock::now();
+            if (now >= target) return;
+            if (std::chrono::duration<double>(target - now).count() > sleepCost()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                // Outliers (a preempted thread) are clamped: no estimate
+                // would have caught them, and they would keep it high.
+                double slept = std::min(std::chrono::duration<double>(Clock::now() - now).count(), 2.0 * sleepCost());
+                double delta = slept - sleepMean;
+                sleepMean += delta / 16.0;
+                sleepVariance += (delta * delta - sleepVariance) / 16.0;
+                poll();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    double sleepCost() const { return sleepMean + 2.0 * std::sqrt(sleepVariance); }
+
+    PacingMode mode;
+    Clock::duration period;
+    Clock::time_point deadline;
+    Clock::time_point lastShown;
+    Clock::time_point workStart;
+    Clock::duration workBudget = std::chrono::milliseconds(4);
+    double sleepMean = 0.0015;          // seconds a 1 ms sleep takes
+    double sleepVariance = 0.00025 * 0.00025;
+};
@@ -0,0 +1,1261 @@
+#pragma once
+
+#include <Box2D/Box2D.h>
+#include <vector>
+#include <random>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "Tunables.h"
+#include "CourseGenerator.h"
+#include "Trace.h"
+#include "Bot.h"
+
+
+const float PIXELS_PER_METER = 50.0f;
+const float METERS_PER_PIXEL = 1.0f / PIXELS_PER_METER;
+
+inline b2Vec2 pixelsToMeters(float x, float y) {
+    return b2Vec2(x * METERS_PER_PIXEL, y * METERS_PER_PIXEL);
+}
+
+inline float lerp(float a, float b, float t) {
+    return a + t * (b - a);
+}
+
+
+enum CollectibleType { Magenta, Orange, Green, Red, White, MinusScore };
+enum PlatformEffect { None, Lengthen, Shorten };
+enum GameMode { SinglePlayerMode, VersusMode };
+
+
+static constexpr uintptr_t GROUND_ID = 2;
+static constexpr uintptr_t CEILING_ID = 3;
+static constexpr uintptr_t MAGENTA_COLLECTIBLE_ID = 4;
+static constexpr uintptr_t ORANGE_COLLECTIBLE_ID = 5;
+static constexpr uintptr_t GREEN_COLLECTIBLE_ID = 6;
+static constexpr uintptr_t RED_COLLECTIBLE_ID = 7;
+static constexpr uintptr_t WHITE_COLLECTIBLE_ID = 8;
+static constexpr uintptr_t MINUS_SCORE_COLLECTIBLE_ID = 9;
+static constexpr uintptr_t PLAYER_ID_BASE = 16;          // + slot, on the player's body fixture
+static constexpr uintptr_t FOOT_SENSOR_ID_BASE = 32;     // + slot, on the player's foot sensor
+static constexpr uintptr_t PLATFORM_ID_BASE = 1000;
+
+static constexpr int MAX_PLAYERS = 8;
+static_assert(PLAYER_ID_BASE + MAX_PLAYERS <= FOOT_SENSOR_ID_BASE &&
+              FOOT_SENSOR_ID_BASE + MAX_PLAYERS <= PLATFORM_ID_BASE, "player fixture ids must not overlap");
+
+// The player slot a fixture's user data belongs to, or -1.
+inline int playerSlotOf(uintptr_t id) {
+    return (id >= PLAYER_ID_BASE && id < PLAYER_ID_BASE + MAX_PLAYERS) ? static_cast<int>(id - PLAYER_ID_BASE) : -1;
+}
+
+inline int footSensorSlotOf(uintptr_t id) {
+    return (id >= FOOT_SENSOR_ID_BASE && id < FOOT_SENSOR_ID_BASE + MAX_PLAYERS) ? static_cast<int>(id - FOOT_SENSOR_ID_BASE) : -1;
+}
+
+
+// Per player slot; plain arrays so contact callbacks never allocate.
+struct ContactCounters {
+    int32_t footContacts[MAX_PLAYERS];      // platforms touching the foot sensor
+    int32_t touchedGround[MAX_PLAYERS];     // 0 or 1; int so there is no padding to snapshot
+};
+
+class PlayerContactListener : public b2ContactListener {
+public:
+    ContactCounters counters = {};
+    std::vector<b2Body*>& collectiblesToRemove;
+
+    PlayerContactListener(std::vector<b2Body*>& bodiesToRemove) : collectiblesToRemove(bodiesToRemove) {}
+
+    void BeginContact(b2Contact* contact) override {
+        b2Fixture* fixtureA = contact->GetFixtureA();
+        b2Fixture* fixtureB = contact->GetFixtureB();
+        uintptr_t userDataA = fixtureA->GetUserData().pointer;
+        uintptr_t userDataB = fixtureB->GetUserData().pointer;
+
+        // Platform Contact via Foot Sensor
+        checkFootContact(userDataA, userDataB, +1);
+        checkFootContact(userDataB, userDataA, +1);
+
+        // Ground and collectibles
+        checkPlayerContact(userDataA, userDataB, fixtureB, true);
+        checkPlayerContact(userDataB, userDataA, fixtureA, true);
+    }
+
+    void EndContact(b2Contact* contact) override {
+        b2Fixture* fixtureA = contact->GetFixtureA();
+        b2Fixture* fixtureB = contact->GetFixtureB();
+        uintptr_t userDataA = fixtureA->GetUserData().pointer;
+        uintptr_t userDataB = fixtureB->GetUserData().pointer;
+
+        // Remove Platform Contact via Foot Sensor
+        checkFootContact(userDataA, userDataB, -1);
+        checkFootContact(userDataB, userDataA, -1);
+
+        // Leaving ground
+        checkPlayerContact(userDataA, userDataB, fixtureB, false);
+        checkPlayerContact(userDataB, userDataA, fixtureA, false);
+    }
+
+    void PreSolve(b2Contact* contact, const b2Manifold* oldManifold) override {
+        b2Fixture* fixtureA = contact->GetFixtureA();
+        b2Fixture* fixtureB = contact->GetFixtureB();
+        uintptr_t userDataA = fixtureA->GetUserData().pointer;
+        uintptr_t userDataB = fixtureB->GetUserData().pointer;
+
+        if ((playerSlotOf(userDataA) >= 0 && userDataB >= PLATFORM_ID_BASE) ||
+            (playerSlotOf(userDataB) >= 0 && userDataA >= PLATFORM_ID_BASE)) {
+            contact->SetFriction(0.0f);
+        }
+    }
+
+    bool isGrounded(int slot) const {
+        return counters.footContacts[slot] > 0;
+    }
+
+    bool hasTouchedGround(int slot) const {
+        return counters.touchedGround[slot] != 0;
+    }
+
+    void reset() {
+        counters = ContactCounters();
+        collectiblesToRemove.clear();
+    }
+
+private:
+    void checkFootContact(uintptr_t footSensorId, uintptr_t otherId, int change) {
+        int slot = footSensorSlotOf(footSensorId);
+        if (slot >= 0 && otherId >= PLATFORM_ID_BASE) {
+            int32_t& count = counters.footContacts[slot];
+            count += change;
+
+            // Avoid negative counts
+            if (count < 0) count = 0;
+        }
+    }
+
+    void checkPlayerContact(uintptr_t playerId, uintptr_t otherId, b2Fixture* otherFixture, bool begin) {
+        int slot = playerSlotOf(playerId);
+        if (slot < 0) return;
+        if (otherId == GROUND_ID) {
+            counters.touchedGround[slot] = begin ? 1 : 0;
+        } else if (begin && isCollectible(otherId)) {
+            collectiblesToRemove.push_back(otherFixture->GetBody());
+        }
+    }
+
+    bool isCollectible(uintptr_t id) const {
+        return (id == MAGENTA_COLLECTIBLE_ID || id == ORANGE_COLLECTIBLE_ID ||
+                id == GREEN_COLLECTIBLE_ID || id == RED_COLLECTIBLE_ID ||
+                id == WHITE_COLLECTIBLE_ID || id == MINUS_SCORE_COLLECTIBLE_ID);
+    }
+};
+
+
+// Function to create a player body and fixtures for the given slot
+inline b2Body* createPlayer(b2World& world, float x, float y, float playerWidth, float playerHeight, int slot) {
+    b2BodyDef playerBodyDef;
+    playerBodyDef.type = b2_dynamicBody;
+    playerBodyDef.position = pixelsToMeters(x, y);
+    playerBodyDef.fixedRotation = true;
+    playerBodyDef.allowSleep = false;
+    b2Body* playerBody = world.CreateBody(&playerBodyDef);
+
+    // Main player body fixture
+    b2PolygonShape playerBox;
+    playerBox.SetAsBox(playerWidth / 2.f * METERS_PER_PIXEL, playerHeight / 2.f * METERS_PER_PIXEL);
+    b2FixtureDef playerFixtureDef;
+    playerFixtureDef.shape = &playerBox;
+    playerFixtureDef.density = 1.0f;
+    playerFixtureDef.friction = 0.5f;
+    playerFixtureDef.restitution = 0.0f;
+    playerFixtureDef.userData.pointer = PLAYER_ID_BASE + slot;
+    playerBody->CreateFixture(&playerFixtureDef);
+
+    // Foot sensor fixture
+    b2PolygonShape footSensorBox;
+    b2Vec2 footSensorCenter = b2Vec2(0, playerHeight / 2.f * METERS_PER_PIXEL);
+    footSensorBox.SetAsBox(playerWidth / 2.f * 0.9f * METERS_PER_PIXEL, 5.f * METERS_PER_PIXEL, footSensorCenter, 0);
+    b2FixtureDef footSensorFixtureDef;
+    footSensorFixtureDef.shape = &footSensorBox;
+    footSensorFixtureDef.isSensor = true;
+    footSensorFixtureDef.userData.pointer = FOOT_SENSOR_ID_BASE + slot;
+    playerBody->CreateFixture(&footSensorFixtureDef);
+
+    return playerBody;
+}
+
+
+struct SimPlayer {
+    b2Body* body = nullptr;
+    bool active = false;        // taking part in this round
+    bool alive = false;
+    bool grounded = false;
+    bool fastFallActive = false;
+    int jumpsRemaining = 0;
+    float jumpBuffer = 0.f;     // seconds a jump pressed with none left stays queued
+    float coyoteLeft = -1.f;    // seconds the ground jump stays usable after leaving the ground; negative until first landed
+    float x = 0.f, y = 0.f;     // pixels, synced after each step
+    float prevX = 0.f, prevY = 0.f;     // before the last step, for drawing between ticks
+};
+
+struct SimPlatform {
+    b2Body* body = nullptr;
+    uintptr_t id = 0;
+    float length = 0.f;
+    float x = 0.f, y = 0.f;     // centre, pixels
+    float prevX = 0.f, prevY = 0.f;
+    PlatformEffect effect = PlatformEffect::None;   // effect active when it spawned, for colouring
+    bool markedForRemoval = false;
+};
+
+struct SimCollectible {
+    b2Body* body = nullptr;
+    uint32_t id = 0;            // unique within a round, for tools that track collectibles
+    CollectibleType type = CollectibleType::Magenta;
+    float x = 0.f, y = 0.f;
+    float prevX = 0.f, prevY = 0.f;
+    bool markedForRemoval = false;
+};
+
+struct BodyState {
+    b2Vec2 position = b2Vec2(0.f, 0.f);     // metres
+    b2Vec2 velocity = b2Vec2(0.f, 0.f);
+    float gravityScale = 1.f;
+};
+
+// What happened during one tick, for sound and UI.
+struct SimEvents {
+    std::vector<CollectibleType> pickups;
+    std::vector<uint32_t> pickupIds;    // matches pickups entry for entry
+    bool roundEnded = false;
+};
+
+
+// A whole game state as one flat byte buffer: a header, then fixed-size
+// records copied in with memcpy. Bodies are stored as BodyStates because a
+// b2World cannot be copied; GameSim::loadState() rebuilds them. The buffer
+// keeps its capacity between saves, so steady-state saving does not allocate.
+struct GameSnapshot {
+    std::vector<uint8_t> bytes;
+};
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t layoutHash;
+    uint32_t platformCount;
+    uint32_t collectibleCount;
+    uint32_t queuedSpecCount;
+};
+
+// Everything in GameSim that is a plain value. The two random generators are
+// copied separately, straight from and into the live objects.
+struct SnapshotScalars {
+    GameMode mode;
+    int playerCount;
+    uint32_t roundSeed;
+    bool roundStarted;
+    bool roundOver;
+    int winner;
+    int score;
+    float gameTime;
+    float blockSpeed;
+    PlatformEffect currentPlatformEffect;
+    float platformEffectTime;
+    bool isRainingMagenta;
+    float magentaRainTime;
+    float magentaRainSpawnTime;
+    PlatformSpec upcomingPlatform;
+    float spawnTime;
+    float nextSpawnTime;
+    uintptr_t nextPlatformId;
+    uint32_t nextCollectibleId;
+    bool courseStarted;
+    CourseParams courseParams;
+};
+
+struct PlayerRecord {
+    bool hasBody;
+    bool active;
+    bool alive;
+    bool grounded;
+    bool fastFallActive;
+    int jumpsRemaining;
+    float jumpBuffer;
+    float coyoteLeft;
+    float x, y;
+    BodyState body;
+};
+
+struct PlatformRecord {
+    uintptr_t id;
+    float length;
+    float x, y;
+    PlatformEffect effect;
+    bool markedForRemoval;
+    BodyState body;
+};
+
+struct CollectibleRecord {
+    uint32_t id;
+    CollectibleType type;
+    float x, y;
+    bool markedForRemoval;
+    BodyState body;
+};
+
+static_assert(std::is_trivially_copyable<SnapshotScalars>::value, "snapshot records are copied with memcpy");
+static_assert(std::is_trivially_copyable<std::mt19937>::value, "random generators are copied with memcpy");
+static_assert(std::is_trivially_copyable<CourseGenerator::GeneratorState>::value, "course state is copied with memcpy");
+static_assert(std::is_trivially_copyable<ContactCounters>::value, "contact counters are copied with memcpy");
+
+// Changes whenever a record changes size, so a buffer saved by another build
+// is rejected rather than misread.
+inline uint32_t snapshotLayoutHash() {
+    uint32_t hash = tunablesLayoutHash();
+    const size_t sizes[] = {
+        sizeof(SnapshotHeader), sizeof(SnapshotScalars), sizeof(std::mt19937), sizeof(CourseGenerator::GeneratorState),
+        sizeof(PlatformSpec), sizeof(PlayerRecord), sizeof(PlatformRecord), sizeof(CollectibleRecord),
+        sizeof(ContactCounters), static_cast<size_t>(MAX_PLAYERS)
+    };
+    for (size_t size : sizes) {
+        hash ^= static_cast<uint32_t>(size);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+// The whole game simulation: Box2D world, players, platforms, collectibles,
+// spawner, scoring and effects. It has no window, textures or sounds; a
+// frontend feeds it PlayerInputs and draws what it exposes. All timers run
+// on simulation time, so a tick sequence with the same seed, dt and inputs
+// plays out the same way.
+class GameSim {
+public:
+    GameSim(const Tunables& tunables, float windowWidth, float windowHeight, bool backgroundCourse = true)
+        : tun(tunables), windowWidth(windowWidth), windowHeight(windowHeight),
+          contactListener(collectiblesToRemove), courseGenerator(backgroundCourse) {
+        createWorld();
+        // Room for the busiest screen up front (magenta rain included), so a
+        // tick never grows these; clear() keeps the capacity between rounds.
+        platforms.reserve(32);
+        collectibles.reserve(128);
+        collectiblesToRemove.reserve(32);
+        for (std::vector<float>* lane : { &syncX, &syncY, &syncMinX, &syncMaxY }) lane->reserve(32 + 128);
+        syncOffscreen.reserve(32 + 128);
+        bodyScratch.reserve(MAX_PLAYERS + 32 + 128);
+        events.pickups.reserve(32);
+        events.pickupIds.reserve(32);
+    }
+
+    GameSim(const GameSim&) = delete;
+    GameSim& operator=(const GameSim&) = delete;
+
+    // Clears the previous round and sets up players and the first platform.
+    // A versus round has playerCount players, 2 to MAX_PLAYERS, in slots
+    // 0 to playerCount - 1; a single-player round always has one.
+    void startRound(GameMode newMode, uint32_t seed, int newPlayerCount = 2) {
+        clearRound();
+        roundStarted = true;
+        mode = newMode;
+        playerCount = (mode == VersusMode) ? std::min(std::max(newPlayerCount, 2), MAX_PLAYERS) : 1;
+        roundSeed = seed;
+        gen.seed(seed);
+        nextCollectibleId = 1;
+        roundOver = false;
+        winner = 0;
+        score = 0;
+        gameTime = 0.f;
+        blockSpeed = tun.startBlockSpeed;
+        currentPlatformEffect = PlatformEffect::None;
+        platformEffectTime = 0.f;
+        isRainingMagenta = false;
+        magentaRainTime = 0.f;
+        magentaRainSpawnTime = 0.f;
+
+        for (int i = 0; i < playerCount; i++) {
+            SimPlayer& player = players[i];
+            // Players 1 and 2 keep their old marks; the rest line up ahead of
+            // player 1, all of them over the first platform.
+            float x = (i < 2) ? windowWidth / 4.f - 100.f * i : windowWidth / 4.f + 100.f * (i - 1);
+            player.body = createPlayer(*world, x, windowHeight - 600.f, tun.playerWidth, tun.playerHeight, i);
+            player.active = true;
+            player.alive = true;
+            player.grounded = false;
+            player.fastFallActive = false;
+            player.jumpsRemaining = tun.maxJumps;
+            player.jumpBuffer = 0.f;
+            // The opening drop is not a walk-off: the countdown only starts
+            // once the player has stood on something.
+            player.coyoteLeft = -1.f;
+            syncPlayer(player);
+            player.prevX = player.x;
+            player.prevY = player.y;
+        }
+
+        spawnPlatform(windowWidth / 2.f, windowHeight - 500.f, windowWidth - 250.f, PlatformEffect::None);
+        startCourse(seed, 0.f);
+    }
+
+    // Hot reload: new values apply to everything spawned or timed from now on.
+    void setTunables(const Tunables& tunables) {
+        tun = tunables;
+        world->SetGravity(b2Vec2(0.0f, tun.gravity));
+        worldRebuilt = false;   // bodies are rebuilt with the new sizes next tick
+        blockSpeed = std::min(blockSpeed, tun.maxBlockSpeed);
+        if (isPlaying()) {
+            startCourse(gen(), std::max(0.f, nextSpawnTime - spawnTime));
+        }
+    }
+
+    // Frees a finished round's bodies, leaving only the ground and ceiling.
+    // Score, winner and time stay readable for the game-over screen.
+    void endRound() {
+        clearRound();
+        roundStarted = false;
+    }
+
+    bool isPlaying() const {
+        return roundStarted && !roundOver;
+    }
+
+    // Advances the game by dt seconds. inputs has one entry per player slot.
+    void tick(float dt, const PlayerInput* inputs) {
+        TraceScope traceTick("tick");
+        events.pickups.clear();
+        events.pickupIds.clear();
+        events.roundEnded = false;
+        if (roundOver) return;
+
+        // Every tick starts from a rebuilt world, built exactly the way
+        // loadState() builds one, so a run restored from a snapshot and a run
+        // that never was step identically. Right after loadState() the world
+        // is already in that form.
+        if (!worldRebuilt) {
+            TraceScope traceRebuild("rebuild");
+            rebuildLiveWorld();
+        }
+
+        gameTime += dt;
+
+        for (int i = 0; i < playerCount; i++) {
+            SimPlayer& player = players[i];
+            if (!player.body) continue;
+            // A press with no jumps left is buffered and taken on the first
+            // tick one is available again, typically right after landing.
+            bool wantsJump = inputs[i].jumpPressed || player.jumpBuffer > 0.f;
+            if (wantsJump && player.jumpsRemaining > 0) {
+                float impulseMagnitude = tun.playerJumpForce * METERS_PER_PIXEL * player.body->GetMass();
+                player.body->ApplyLinearImpulseToCenter(b2Vec2(0, -impulseMagnitude), true);
+                player.jumpsRemaining--;
+                player.jumpBuffer = 0.f;
+            } else if (inputs[i].jumpPressed) {
+                player.jumpBuffer = tun.jumpBufferTime;
+            } else {
+                player.jumpBuffer = std::max(0.f, player.jumpBuffer - dt);
+            }
+            player.fastFallActive = inputs[i].fastFall;
+
+            // Apply fast fall gravity scale if active and not grounded. Uses the
+            // grounded flag from the last tick rather than the listener, so the
+            // first tick after loadState() sees the same value.
+            if (player.fastFallActive && !player.grounded) {
+                player.body->SetGravityScale(tun.fastFallGravityScale);
+            } else {
+                player.body->SetGravityScale(1.0f);
+            }
+        }
+
+        {
+            TraceScope traceStep("world step");
+            world->Step(dt, 8, 3);
+            worldRebuilt = false;
+        }
+
+        for (int i = 0; i < playerCount; i++) {
+            if (players[i].body) syncPlayer(players[i]);
+        }
+
+        syncBodies();
+
+        TraceScope traceContacts("contacts");
+        for (b2Body* bodyToRemove : collectiblesToRemove) {
+            for (auto it = collectibles.begin(); it != collectibles.end(); ++it) {
+                if (it->body == bodyToRemove) {
+                    if (!it->markedForRemoval && mode == SinglePlayerMode) {
+                        applyPickup(it->type);
+                        events.pickupIds.push_back(it->id);
+                    }
+                    it->markedForRemoval = true;
+                    break;
+                }
+            }
+        }
+        collectiblesToRemove.clear();
+        traceContacts.end();
+
+        TraceScope traceRemoval("removal");
+        platforms.erase(std::remove_if(platforms.begin(), platforms.end(), [&](SimPlatform& platform) {
+            if (platform.markedForRemoval && platform.body) {
+                world->DestroyBody(platform.body);
+                platform.body = nullptr;
+                return true;
+            }
+            return false;
+        }), platforms.end());
+
+        collectibles.erase(std::remove_if(collectibles.begin(), collectibles.end(), [&](SimCollectible& collectible) {
+            if (collectible.markedForRemoval && collectible.body) {
+                world->DestroyBody(collectible.body);
+                collectible.body = nullptr;
+                return true;
+            }
+            return false;
+        }), collectibles.end());
+        traceRemoval.end();
+
+        updatePlayers(dt);
+        if (roundOver) {
+            events.roundEnded = true;
+            return;
+        }
+
+        TraceScope traceSpawn("spawn");
+        if (mode == SinglePlayerMode) {
+            updateEffects(dt);
+        }
+
+        spawnTime += dt;
+        if (spawnTime >= nextSpawnTime) {
+            spawnFromCourse();
+        }
+
+        if (blockSpeed < tun.maxBlockSpeed) {
+            blockSpeed += tun.blockSpeedIncreaseFactor * dt;
+            blockSpeed = std::min(blockSpeed, tun.maxBlockSpeed);
+        }
+    }
+
+    // Captures the state between two ticks into a flat buffer, in a few
+    // microseconds: a handful of memcpys plus one record per body.
+    void saveState(GameSnapshot& out) {
+        courseGenerator.save(courseScratch);
+
+        SnapshotHeader header;
+        std::memcpy(header.magic, "RRSS", 4);
+        header.layoutHash = snapshotLayoutHash();
+        header.platformCount = static_cast<uint32_t>(platforms.size());
+        header.collectibleCount = static_cast<uint32_t>(collectibles.size());
+        header.queuedSpecCount = static_cast<uint32_t>(courseScratch.queue.size());
+        out.bytes.resize(snapshotSize(header));
+        uint8_t* cursor = out.bytes.data();
+        auto put = [&cursor](const void* data, size_t size) {
+            std::memcpy(cursor, data, size);
+            cursor += size;
+        };
+        put(&header, sizeof(header));
+
+        SnapshotScalars scalars;
+        std::memset(static_cast<void*>(&scalars), 0, sizeof(scalars));   // padding too, so equal states give equal bytes
+        scalars.mode = mode;
+        scalars.playerCount = playerCount;
+        scalars.roundSeed = roundSeed;
+        scalars.roundStarted = roundStarted;
+        scalars.roundOver = roundOver;
+        scalars.winner = winner;
+        scalars.score = score;
+        scalars.gameTime = gameTime;
+        scalars.blockSpeed = blockSpeed;
+        scalars.currentPlatformEffect = currentPlatformEffect;
+        scalars.platformEffectTime = platformEffectTime;
+        scalars.isRainingMagenta = isRainingMagenta;
+        scalars.magentaRainTime = magentaRainTime;
+        scalars.magentaRainSpawnTime = magentaRainSpawnTime;
+        scalars.upcomingPlatform = upcomingPlatform;
+        scalars.spawnTime = spawnTime;
+        scalars.nextSpawnTime = nextSpawnTime;
+        scalars.nextPlatformId = nextPlatformId;
+        scalars.nextCollectibleId = nextCollectibleId;
+        scalars.courseStarted = courseScratch.started;
+        scalars.courseParams = courseScratch.params;
+        put(&scalars, sizeof(scalars));
+        put(&gen, sizeof(gen));
+        put(&courseScratch.state, sizeof(courseScratch.state));
+        if (!courseScratch.queue.empty()) put(courseScratch.queue.data(), courseScratch.queue.size() * sizeof(PlatformSpec));
+
+        for (const SimPlayer& player : players) {
+            PlayerRecord record;
+            std::memset(static_cast<void*>(&record), 0, sizeof(record));
+            record.hasBody = player.body != nullptr;
+            record.active = player.active;
+            record.alive = player.alive;
+            record.grounded = player.grounded;
+            record.fastFallActive = player.fastFallActive;
+            record.jumpsRemaining = player.jumpsRemaining;
+            record.jumpBuffer = player.jumpBuffer;
+            record.coyoteLeft = player.coyoteLeft;
+            record.x = player.x;
+            record.y = player.y;
+            record.body = player.body ? captureBody(player.body) : BodyState();
+            put(&record, sizeof(record));
+        }
+        for (const SimPlatform& platform : platforms) {
+            PlatformRecord record;
+            std::memset(static_cast<void*>(&record), 0, sizeof(record));
+            record.id = platform.id;
+            record.length = platform.length;
+            record.x = platform.x;
+            record.y = platform.y;
+            record.effect = platform.effect;
+            record.markedForRemoval = platform.markedForRemoval;
+            record.body = captureBody(platform.body);
+            put(&record, sizeof(record));
+        }
+        for (const SimCollectible& collectible : collectibles) {
+            CollectibleRecord record;
+            std::memset(static_cast<void*>(&record), 0, sizeof(record));
+            record.id = collectible.id;
+            record.type = collectible.type;
+            record.x = collectible.x;
+            record.y = collectible.y;
+            record.markedForRemoval = collectible.markedForRemoval;
+            record.body = captureBody(collectible.body);
+            put(&record, sizeof(record));
+        }
+        put(&contactListener.counters, sizeof(ContactCounters));
+    }
+
+    // Restores a saved state into a freshly built world and returns false,
+    // leaving the game untouched, if the buffer is not a snapshot from this
+    // build. Tunables are not part of the snapshot. See rebuildWorld() for
+    // how the bodies come back; since tick() puts the live world through
+    // the same rebuild, a restored run matches the run it was saved from
+    // exactly, which rollback and SnapshotCheck rely on.
+    bool loadState(const GameSnapshot& in) {
+        SnapshotHeader header;
+        if (in.bytes.size() < sizeof(header)) return false;
+        std::memcpy(&header, in.bytes.data(), sizeof(header));
+        if (std::memcmp(header.magic, "RRSS", 4) != 0 || header.layoutHash != snapshotLayoutHash() ||
+            in.bytes.size() != snapshotSize(header)) {
+            return false;
+        }
+        const uint8_t* cursor = in.bytes.data() + sizeof(header);
+        auto get = [&cursor](void* data, size_t size) {
+            std::memcpy(data, cursor, size);
+            cursor += size;
+        };
+
+        SnapshotScalars scalars;
+        get(&scalars, sizeof(scalars));
+        mode = scalars.mode;
+        playerCount = scalars.playerCount;
+        roundSeed = scalars.roundSeed;
+        roundStarted = scalars.roundStarted;
+        roundOver = scalars.roundOver;
+        winner = scalars.winner;
+        score = scalars.score;
+        gameTime = scalars.gameTime;
+        blockSpeed = scalars.blockSpeed;
+        currentPlatformEffect = scalars.currentPlatformEffect;
+        platformEffectTime = scalars.platformEffectTime;
+        isRainingMagenta = scalars.isRainingMagenta;
+        magentaRainTime = scalars.magentaRainTime;
+        magentaRainSpawnTime = scalars.magentaRainSpawnTime;
+        upcomingPlatform = scalars.upcomingPlatform;
+        spawnTime = scalars.spawnTime;
+        nextSpawnTime = scalars.nextSpawnTime;
+        nextPlatformId = scalars.nextPlatformId;
+        nextCollectibleId = scalars.nextCollectibleId;
+        get(&gen, sizeof(gen));
+        courseScratch.started = scalars.courseStarted;
+        courseScratch.params = scalars.courseParams;
+        get(&courseScratch.state, sizeof(courseScratch.state));
+        courseScratch.queue.resize(header.queuedSpecCount);
+        if (header.queuedSpecCount > 0) get(courseScratch.queue.data(), header.queuedSpecCount * sizeof(PlatformSpec));
+        courseGenerator.load(courseScratch);
+
+        bodyScratch.clear();
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+            PlayerRecord record;
+            get(&record, sizeof(record));
+            SimPlayer& player = players[i];
+            player = SimPlayer();
+            player.active = record.active;
+            player.alive = record.alive;
+            player.grounded = record.grounded;
+            player.fastFallActive = record.fastFallActive;
+            player.jumpsRemaining = record.jumpsRemaining;
+            player.jumpBuffer = record.jumpBuffer;
+            player.coyoteLeft = record.coyoteLeft;
+            player.x = player.prevX = record.x;
+            player.y = player.prevY = record.y;
+            playerHasBody[i] = record.hasBody;
+            if (record.hasBody) bodyScratch.push_back(record.body);
+        }
+        platforms.resize(header.platformCount);
+        for (SimPlatform& platform : platforms) {
+            PlatformRecord record;
+            get(&record, sizeof(record));
+            platform.id = record.id;
+            platform.length = record.length;
+            platform.x = platform.prevX = record.x;
+            platform.y = platform.prevY = record.y;
+            platform.effect = record.effect;
+            platform.markedForRemoval = record.markedForRemoval;
+            bodyScratch.push_back(record.body);
+        }
+        collectibles.resize(header.collectibleCount);
+        for (SimCollectible& collectible : collectibles) {
+            CollectibleRecord record;
+            get(&record, sizeof(record));
+            collectible.id = record.id;
+            collectible.type = record.type;
+            collectible.x = collectible.prevX = record.x;
+            collectible.y = collectible.prevY = record.y;
+            collectible.markedForRemoval = record.markedForRemoval;
+            bodyScratch.push_back(record.body);
+        }
+        ContactCounters counters;
+        get(&counters, sizeof(counters));
+        rebuildWorld(counters);
+
+        events.pickups.clear();
+        events.pickupIds.clear();
+        events.roundEnded = false;
+        return true;
+    }
+
+    // FNV-1a over positions, velocities, timers and score, for spotting two
+    // simulations that should agree but do not.
+    uint64_t stateChecksum() const {
+        uint64_t hash = 1469598103934665603ull;
+        auto mix = [&hash](const void* data, size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        };
+        auto mixBody = [&mix](const b2Body* body) {
+            b2Vec2 position = body->GetPosition();
+            b2Vec2 velocity = body->GetLinearVelocity();
+            mix(&position, sizeof(position));
+            mix(&velocity, sizeof(velocity));
+        };
+        mix(&gameTime, sizeof(gameTime));
+        mix(&blockSpeed, sizeof(blockSpeed));
+        mix(&score, sizeof(score));
+        mix(&winner, sizeof(winner));
+        mix(&roundOver, sizeof(roundOver));
+        for (const SimPlayer& player : players) {
+            if (!player.active) continue;
+            mix(&player.alive, sizeof(player.alive));
+            mix(&player.jumpsRemaining, sizeof(player.jumpsRemaining));
+            mix(&player.jumpBuffer, sizeof(player.jumpBuffer));
+            mix(&player.coyoteLeft, sizeof(player.coyoteLeft));
+            if (player.body) mixBody(player.body);
+        }
+        for (const SimPlatform& platform : platforms) {
+            mix(&platform.id, sizeof(platform.id));
+            mixBody(platform.body);
+        }
+        for (const SimCollectible& collectible : collectibles) {
+            mix(&collectible.type, sizeof(collectible.type));
+            mixBody(collectible.body);
+        }
+        return hash;
+    }
+
+    // Fills a bot observation for the given player slot, in pixels.
+    void observe(int playerIndex, BotObservation& obs) const {
+        const SimPlayer& player = players[playerIndex];
+        obs.playerX = player.x;
+        obs.playerY = player.y;
+        obs.playerVY = player.body ? player.body->GetLinearVelocity().y * PIXELS_PER_METER : 0.f;
+        obs.grounded = player.grounded;
+        obs.jumpsRemaining = player.jumpsRemaining;
+        obs.jumpBuffer = player.jumpBuffer;
+        obs.coyoteLeft = player.coyoteLeft;
+        obs.blockSpeed = blockSpeed;
+        // Sized like ours, so a new record number of platforms does not grow it mid-round.
+        obs.platforms.reserve(platforms.capacity());
+        obs.collectibles.reserve(collectibles.capacity());
+        obs.platforms.clear();
+        for (const auto& platform : platforms) {
+            float halfLength = platform.length / 2.f;
+            obs.platforms.push_back({ platform.x - halfLength, platform.x + halfLength, platform.y - tun.fixedHeight / 2.f });
+        }
+        obs.collectibles.clear();
+        for (const auto& collectible : collectibles) {
+            b2Vec2 velocity = collectible.body->GetLinearVelocity();
+            obs.collectibles.push_back({ collectible.x, collectible.y, velocity.x * PIXELS_PER_METER,
+                                         velocity.y * PIXELS_PER_METER, collectibleValue(collectible.type) });
+        }
+    }
+
+    // How much a pickup is worth to a player or a learning agent.
+    float collectibleValue(CollectibleType type) const {
+        switch (type) {
+            case CollectibleType::Magenta: return static_cast<float>(tun.magentaScore);
+            case CollectibleType::Orange: return static_cast<float>(tun.orangeScore);
+            case CollectibleType::Green: return 1.f;
+            case CollectibleType::Red: return -1.f;
+            case CollectibleType::White: return 3.f;
+            case CollectibleType::MinusScore: return -static_cast<float>(tun.minusScorePenalty);
+        }
+        return 0.f;
+    }
+
+    Tunables tun;
+    const float windowWidth;
+    const float windowHeight;
+
+    GameMode mode = SinglePlayerMode;
+    int playerCount = 0;        // slots 0 to playerCount - 1 take part in the round
+    uint32_t roundSeed = 0;
+    bool roundOver = false;
+    int winner = 0;             // versus: the last player standing's slot + 1, 0 for a tie
+    int score = 0;
+    float gameTime = 0.f;
+    float blockSpeed = 200.f;
+    PlatformEffect currentPlatformEffect = PlatformEffect::None;
+    float platformEffectTime = 0.f;
+    bool isRainingMagenta = false;
+    float magentaRainTime = 0.f;
+    float magentaRainSpawnTime = 0.f;
+
+    SimPlayer players[MAX_PLAYERS];
+    std::vector<SimPlatform> platforms;
+    std::vector<SimCollectible> collectibles;
+    SimEvents events;
+
+    std::vector<b2Body*> collectiblesToRemove;  // filled by the contact listener during Step
+    std::unique_ptr<b2World> world;             // rebuilt by loadState() and at the start of every tick
+    PlayerContactListener contactListener;
+
+private:
+    // New world with only the ground and ceiling in it. Any bodies in the old
+    // world go with it. After the first one the world is rebuilt in place, so
+    // the per-tick rebuild does not go through operator new; Box2D takes the
+    // world's own storage from b2Alloc.
+    void createWorld() {
+        if (world) {
+            world->~b2World();
+            new (world.get()) b2World(b2Vec2(0.0f, tun.gravity));
+        } else {
+            world.reset(new b2World(b2Vec2(0.0f, tun.gravity)));
+        }
+        world->SetContactListener(&contactListener);
+
+        b2BodyDef groundBodyDef;
+        groundBodyDef.position = pixelsToMeters(windowWidth / 2.f, windowHeight + 50.f);
+        b2Body* groundBody = world->CreateBody(&groundBodyDef);
+        b2PolygonShape groundBox;
+        groundBox.SetAsBox(windowWidth / 2.f * METERS_PER_PIXEL, 10.f * METERS_PER_PIXEL);
+        b2Fixture* groundFixture = groundBody->CreateFixture(&groundBox, 0.0f);
+        groundFixture->GetUserData().pointer = GROUND_ID;
+
+        b2BodyDef ceilingBodyDef;
+        ceilingBodyDef.position = pixelsToMeters(windowWidth / 2.f, -10.f);
+        b2Body* ceilingBody = world->CreateBody(&ceilingBodyDef);
+        b2PolygonShape ceilingBox;
+        ceilingBox.SetAsBox(windowWidth / 2.f * METERS_PER_PIXEL, 10.f * METERS_PER_PIXEL);
+        b2Fixture* ceilingFixture = ceilingBody->CreateFixture(&ceilingBox, 0.0f);
+        ceilingFixture->GetUserData().pointer = CEILING_ID;
+    }
+
+    // Replaces the world with a new one holding the same bodies, taken from
+    // bodyScratch: one BodyState per player with a body (playerHasBody, by
+    // slot), then per platform, then per collectible. Bodies are created in
+    // that fixed order and a zero-length step finds their contacts, so the
+    // result depends only on those states, never on what the old world went
+    // through. Nothing moves in that step; the contact counters it produces
+    // are replaced by the given ones, and a collectible it reports stays
+    // queued for the next tick, where it would have been picked up anyway.
+    // Contacts start without warm-start impulses, every tick alike.
+    void rebuildWorld(const ContactCounters& counters) {
+        createWorld();
+        contactListener.reset();
+        const BodyState* state = bodyScratch.data();
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+            SimPlayer& player = players[i];
+            player.body = nullptr;
+            if (!playerHasBody[i]) continue;
+            player.body = createPlayer(*world, player.x, player.y, tun.playerWidth, tun.playerHeight, i);
+            restoreBody(player.body, *state++);
+        }
+        for (SimPlatform& platform : platforms) {
+            platform.body = createPlatformBody(platform.id, platform.length, state->position, state->velocity);
+            state++;
+        }
+        for (SimCollectible& collectible : collectibles) {
+            collectible.body = createCollectibleBody(collectible.type, state->position, state->velocity);
+            state++;
+        }
+        world->Step(0.f, 8, 3);
+        contactListener.counters = counters;
+        worldRebuilt = true;
+    }
+
+    // rebuildWorld() from the live bodies.
+    void rebuildLiveWorld() {
+        bodyScratch.clear();
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+            playerHasBody[i] = players[i].body != nullptr;
+            if (players[i].body) bodyScratch.push_back(captureBody(players[i].body));
+        }
+        for (const SimPlatform& platform : platforms) bodyScratch.push_back(captureBody(platform.body));
+        for (const SimCollectible& collectible : collectibles) bodyScratch.push_back(captureBody(collectible.body));
+        ContactCounters counters = contactListener.counters;
+        rebuildWorld(counters);
+    }
+
+    static BodyState captureBody(const b2Body* body) {
+        BodyState state;
+        state.position = body->GetPosition();
+        state.velocity = body->GetLinearVelocity();
+        state.gravityScale = body->GetGravityScale();
+        return state;
+    }
+
+    static void restoreBody(b2Body* body, const BodyState& state) {
+        body->SetTransform(state.position, 0.f);
+        body->SetLinearVelocity(state.velocity);
+        body->SetGravityScale(state.gravityScale);
+    }
+
+    static size_t snapshotSize(const SnapshotHeader& header) {
+        return sizeof(SnapshotHeader) + sizeof(SnapshotScalars) + sizeof(std::mt19937) +
+               sizeof(CourseGenerator::GeneratorState) + header.queuedSpecCount * sizeof(PlatformSpec) +
+               MAX_PLAYERS * sizeof(PlayerRecord) + header.platformCount * sizeof(PlatformRecord) +
+               header.collectibleCount * sizeof(CollectibleRecord) + sizeof(ContactCounters);
+    }
+
+    // Copies every platform's and collectible's new position, in pixels,
+    // out of Box2D and marks the ones that have left the screen: platforms
+    // past the left edge, collectibles past the left edge or the bottom.
+    // Positions are gathered into contiguous arrays first, so scaling and
+    // the tests run four bodies at a time with SSE2 (one at a time
+    // elsewhere, with the same results bit for bit), then written back.
+    void syncBodies() {
+        TraceScope traceSync("sync");
+        const float infinity = std::numeric_limits<float>::infinity();
+        size_t platformCount = platforms.size();
+        size_t total = platformCount + collectibles.size();
+        size_t padded = (total + 3) & ~size_t(3);
+        for (std::vector<float>* lane : { &syncX, &syncY, &syncMinX, &syncMaxY }) lane->resize(padded);
+        syncOffscreen.resize(padded);
+
+        for (size_t i = 0; i < platformCount; i++) {
+            b2Vec2 position = platforms[i].body->GetPosition();
+            syncX[i] = position.x;
+            syncY[i] = position.y;
+            syncMinX[i] = -platforms[i].length / 2.f;
+            syncMaxY[i] = infinity;
+        }
+        for (size_t i = platformCount; i < total; i++) {
+            b2Vec2 position = collectibles[i - platformCount].body->GetPosition();
+            syncX[i] = position.x;
+            syncY[i] = position.y;
+            syncMinX[i] = -tun.collectibleRadius;
+            syncMaxY[i] = windowHeight + tun.collectibleRadius;
+        }
+        for (size_t i = total; i < padded; i++) {
+            syncX[i] = syncY[i] = 0.f;
+            syncMinX[i] = -infinity;
+            syncMaxY[i] = infinity;
+        }
+
+        size_t i = 0;
+#ifdef __SSE2__
+        const __m128 scale = _mm_set1_ps(PIXELS_PER_METER);
+        for (; i < padded; i += 4) {
+            __m128 x = _mm_mul_ps(_mm_loadu_ps(&syncX[i]), scale);
+            __m128 y = _mm_mul_ps(_mm_loadu_ps(&syncY[i]), scale);
+            _mm_storeu_ps(&syncX[i], x);
+            _mm_storeu_ps(&syncY[i], y);
+            __m128 offscreen = _mm_or_ps(_mm_cmplt_ps(x, _mm_loadu_ps(&syncMinX[i])), _mm_cmpgt_ps(y, _mm_loadu_ps(&syncMaxY[i])));
+            int mask = _mm_movemask_ps(offscreen);
+            for (int lane = 0; lane < 4; lane++) syncOffscreen[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+#endif
+        for (; i < padded; i++) {
+            syncX[i] *= PIXELS_PER_METER;
+            syncY[i] *= PIXELS_PER_METER;
+            syncOffscreen[i] = (syncX[i] < syncMinX[i] || syncY[i] > syncMaxY[i]) ? 1 : 0;
+        }
+
+        for (size_t i = 0; i < platformCount; i++) {
+            SimPlatform& platform = platforms[i];
+            platform.prevX = platform.x;
+            platform.prevY = platform.y;
+            platform.x = syncX[i];
+            platform.y = syncY[i];
+            if (syncOffscreen[i]) platform.markedForRemoval = true;
+        }
+        for (size_t i = platformCount; i < total; i++) {
+            SimCollectible& collectible = collectibles[i - platformCount];
+            collectible.prevX = collectible.x;
+            collectible.prevY = collectible.y;
+            collectible.x = syncX[i];
+            collectible.y = syncY[i];
+            if (syncOffscreen[i]) collectible.markedForRemoval = true;
+        }
+    }
+
+    void syncPlayer(SimPlayer& player) {
+        b2Vec2 position = player.body->GetPosition();
+        player.prevX = player.x;
+        player.prevY = player.y;
+        player.x = position.x * PIXELS_PER_METER;
+        player.y = position.y * PIXELS_PER_METER;
+    }
+
+    void clearRound() {
+        worldRebuilt = false;
+        for (SimPlayer& player : players) {
+            if (player.body) world->DestroyBody(player.body);
+            player = SimPlayer();
+        }
+        for (auto& platform : platforms) {
+            if (platform.body) world->DestroyBody(platform.body);
+        }
+        platforms.clear();
+        for (auto& collectible : collectibles) {
+            if (collectible.body) world->DestroyBody(collectible.body);
+        }
+        collectibles.clear();
+        contactListener.reset();
+    }
+
+    void startCourse(uint32_t seed, float firstDelay) {
+        CourseParams params;
+        params.tun = tun;
+        params.windowWidth = windowWidth;
+        params.windowHeight = windowHeight;
+        params.pixelsPerMeter = PIXELS_PER_METER;
+        params.playerX = windowWidth / 4.f;
+        params.firstDelay = firstDelay;
+        if (!platforms.empty()) {
+            params.hasPreviousPlatform = true;
+            params.previousRightEdge = platforms.back().x + platforms.back().length / 2.f;
+            params.previousY = platforms.back().y;
+        }
+        courseGenerator.restart(params, seed, gameTime);
+        upcomingPlatform = courseGenerator.next();
+        nextSpawnTime = upcomingPlatform.delay;
+        spawnTime = 0.f;
+    }
+
+    SimPlatform& spawnPlatform(float x, float y, float length, PlatformEffect effect) {
+        SimPlatform platform;
+        platform.length = length;
+        platform.x = platform.prevX = x;
+        platform.y = platform.prevY = y;
+        platform.effect = effect;
+
+        platform.id = nextPlatformId++;
+        platform.body = createPlatformBody(platform.id, length, pixelsToMeters(x, y),
+                                           b2Vec2(-blockSpeed * METERS_PER_PIXEL, 0.0f));
+        platforms.push_back(platform);
+        return platforms.back();
+    }
+
+    b2Body* createPlatformBody(uintptr_t id, float length, b2Vec2 position, b2Vec2 velocity) {
+        b2BodyDef blockBodyDef;
+        blockBodyDef.type = b2_kinematicBody;
+        blockBodyDef.position = position;
+        b2Body* body = world->CreateBody(&blockBodyDef);
+
+        b2PolygonShape blockBox;
+        blockBox.SetAsBox(length / 2.f * METERS_PER_PIXEL, tun.fixedHeight / 2.f * METERS_PER_PIXEL);
+        b2FixtureDef blockFixtureDef;
+        blockFixtureDef.shape = &blockBox;
+        blockFixtureDef.friction = 0.7f;
+        blockFixtureDef.userData.pointer = id;
+        body->CreateFixture(&blockFixtureDef);
+
+        body->SetLinearVelocity(velocity);
+        return body;
+    }
+
+    void spawnCollectible(float x, float y, CollectibleType type, b2Vec2 velocity) {
+        SimCollectible collectible;
+        collectible.id = nextCollectibleId++;
+        collectible.type = type;
+        collectible.x = collectible.prevX = x;
+        collectible.y = collectible.prevY = y;
+        collectible.body = createCollectibleBody(type, pixelsToMeters(x, y), velocity);
+        collectibles.push_back(collectible);
+    }
+
+    b2Body* createCollectibleBody(CollectibleType type, b2Vec2 position, b2Vec2 velocity) {
+        static const uintptr_t userDataForType[] = {
+            MAGENTA_COLLECTIBLE_ID, ORANGE_COLLECTIBLE_ID, GREEN_COLLECTIBLE_ID,
+            RED_COLLECTIBLE_ID, WHITE_COLLECTIBLE_ID, MINUS_SCORE_COLLECTIBLE_ID
+        };
+        b2BodyDef collectibleBodyDef;
+        collectibleBodyDef.type = b2_kinematicBody;
+        collectibleBodyDef.position = position;
+        b2Body* body = world->CreateBody(&collectibleBodyDef);
+
+        b2CircleShape collectibleCircle;
+        collectibleCircle.m_radius = tun.collectibleRadius * METERS_PER_PIXEL;
+        b2FixtureDef collectibleFixtureDef;
+        collectibleFixtureDef.shape = &collectibleCircle;
+        collectibleFixtureDef.isSensor = true;
+        collectibleFixtureDef.userData.pointer = userDataForType[type];
+        body->CreateFixture(&collectibleFixtureDef);
+
+        body->SetLinearVelocity(velocity);
+        return body;
+    }
+
+    void applyPickup(CollectibleType type) {
+        switch (type) {
+            case CollectibleType::Magenta: score += tun.magentaScore; break;
+            case CollectibleType::Orange: score += tun.orangeScore; break;
+            case CollectibleType::Green: currentPlatformEffect = PlatformEffect::Lengthen; platformEffectTime = 0.f; break;
+            case CollectibleType::Red: currentPlatformEffect = PlatformEffect::Shorten; platformEffectTime = 0.f; break;
+            case CollectibleType::White: isRainingMagenta = true; magentaRainTime = 0.f; magentaRainSpawnTime = 0.f; break;
+            case CollectibleType::MinusScore: score = std::max(0, score - tun.minusScorePenalty); break;
+        }
+        events.pickups.push_back(type);
+    }
+
+    void updatePlayers(float dt) {
+        for (int i = 0; i < playerCount; i++) {
+            SimPlayer& player = players[i];
+            if (!player.body) continue;
+            player.grounded = contactListener.isGrounded(i);
+            if (player.grounded) {
+                player.jumpsRemaining = tun.maxJumps;
+                player.coyoteLeft = tun.coyoteTime;
+            } else if (tun.coyoteTime >= 0.f && player.coyoteLeft >= 0.f && player.jumpsRemaining == tun.maxJumps &&
+                       player.jumpsRemaining > 0) {
+                // Walked off without jumping: the ground jump lapses once
+                // coyote time is up.
+                player.coyoteLeft -= dt;
+                if (player.coyoteLeft <= 0.f) {
+                    player.coyoteLeft = 0.f;
+                    player.jumpsRemaining--;
+                }
+            }
+
+            bool fellOut = player.y > windowHeight + tun.playerHeight || player.x < -tun.playerWidth;
+            if (contactListener.hasTouchedGround(i) || fellOut) {
+                player.alive = false;
+                world->DestroyBody(player.body);
+                player.body = nullptr;
+            }
+        }
+
+        // Single player ends with the player; versus once at most one is
+        // left, who wins. Everyone falling on the same tick is a tie.
+        int aliveCount = 0;
+        int lastAlive = -1;
+        for (int i = 0; i < playerCount; i++) {
+            if (players[i].alive) {
+                aliveCount++;
+                lastAlive = i;
+            }
+        }
+        if (aliveCount == 0 || (mode == VersusMode && aliveCount == 1)) {
+            roundOver = true;
+            winner = (mode == VersusMode && aliveCount == 1) ? lastAlive + 1 : 0;
+        }
+    }
+
+    void updateEffects(float dt) {
+        if (currentPlatformEffect != PlatformEffect::None) {
+            platformEffectTime += dt;
+            if (platformEffectTime >= tun.platformEffectDuration) {
+                currentPlatformEffect = PlatformEffect::None;
+            }
+        }
+        if (isRainingMagenta) {
+            magentaRainTime += dt;
+            magentaRainSpawnTime += dt;
+            if (magentaRainTime >= tun.magentaRainDuration) {
+                isRainingMagenta = false;
+            } else if (magentaRainSpawnTime >= tun.magentaRainSpawnInterval) {
+                std::uniform_real_distribution<float> rainXPosDist(tun.collectibleRadius, windowWidth - tun.collectibleRadius);
+                spawnCollectible(rainXPosDist(gen), -tun.collectibleRadius, CollectibleType::Magenta,
+                                 b2Vec2(0.0f, tun.magentaRainSpeed * METERS_PER_PIXEL));
+                magentaRainSpawnTime = 0.f;
+            }
+        }
+    }
+
+    void spawnFromCourse() {
+        float currentMinLength = tun.baseMinLength;
+        float currentMaxLength = tun.baseMaxLength;
+        if (mode == SinglePlayerMode) {
+            if (currentPlatformEffect == PlatformEffect::Lengthen) {
+                currentMinLength = tun.baseMinLength * tun.lengthenFactor;
+                currentMaxLength = tun.baseMaxLength * tun.lengthenFactor;
+            } else if (currentPlatformEffect == PlatformEffect::Shorten) {
+                currentMinLength = tun.baseMinLength * tun.shortenFactor;
+                currentMaxLength = tun.baseMaxLength * tun.shortenFactor;
+            }
+        }
+
+        float blockLength = lerp(currentMinLength, currentMaxLength, upcomingPlatform.lengthT);
+        float spawnX = windowWidth + blockLength / 2.f;
+        float spawnY = upcomingPlatform.spawnY;
+
+        // The generator already kept this spec clear of the platform before it.
+        PlatformEffect effect = (mode == SinglePlayerMode) ? currentPlatformEffect : PlatformEffect::None;
+        SimPlatform& platform = spawnPlatform(spawnX, spawnY, blockLength, effect);
+        b2Vec2 platformVelocity = platform.body->GetLinearVelocity();
+
+        if (mode == SinglePlayerMode && upcomingPlatform.hasCollectible) {
+            float collectibleY = spawnY - (tun.fixedHeight / 2.f + tun.collectibleRadius + 5.f);
+            spawnCollectible(spawnX, collectibleY, pickCollectibleType(upcomingPlatform.collectibleTypeRoll), platformVelocity);
+        }
+
+        spawnTime = 0.f;
+        upcomingPlatform = courseGenerator.next();
+        nextSpawnTime = upcomingPlatform.delay;
+    }
+
+    CollectibleType pickCollectibleType(float typeRoll) const {
+        float threshold = tun.magentaCollectibleProb;
+        if (typeRoll < threshold) return CollectibleType::Magenta;
+        threshold += tun.orangeCollectibleProb;
+        if (typeRoll < threshold) return CollectibleType::Orange;
+        threshold += tun.greenCollectibleProb;
+        if (typeRoll < threshold) return CollectibleType::Green;
+        threshold += tun.redCollectibleProb;
+        if (typeRoll < threshold) return CollectibleType::Red;
+        threshold += tun.whiteCollectibleProb;
+        if (typeRoll < threshold) return CollectibleType::White;
+        return CollectibleType::MinusScore;
+    }
+
+    std::mt19937 gen;
+    bool roundStarted = false;
+    CourseGenerator courseGenerator;
+    CourseGenerator::Snapshot courseScratch;    // reused by saveState()/loadState()
+    std::vector<BodyState> bodyScratch;         // rebuildWorld() input
+    bool playerHasBody[MAX_PLAYERS] = {};
+    bool worldRebuilt = false;                  // the world is as rebuildWorld() left it
+    PlatformSpec upcomingPlatform;
+    float spawnTime = 0.f;      // seconds since the last spawn
+    float nextSpawnTime = 0.f;
+    uintptr_t nextPlatformId = PLATFORM_ID_BASE;
+    // syncBodies() scratch: platforms then collectibles, padded to a multiple of four.
+    std::vector<float> syncX, syncY, syncMinX, syncMaxY;
+    std::vector<uint8_t> syncOffscreen;
+    uint32_t nextCollectibleId = 1;
+};
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include "AtomicFile.h"
+
+
+static constexpr float GHOST_SAMPLE_RATE = 60.f;        // samples per second of game time
+static constexpr float GHOST_UNITS_PER_PIXEL = 4.f;     // positions are stored in quarter pixels
+static constexpr uint32_t GHOSTS_VERSION = 1;
+
+
+// One recorded run. data holds `samples` encoded samples, each:
+//   varint(zigzag(second difference of y))
+//   varint(zigzag(first difference of x) << 1 | grounded)
+// Under gravity the second difference of y is almost always -1, 0 or 1 and
+// x only moves when a platform edge pushes the player, so a typical sample
+// is two bytes.
+struct GhostTrack {
+    int32_t score = 0;
+    uint32_t seed = 0;
+    uint32_t samples = 0;
+    std::vector<uint8_t> data;
+};
+
+inline uint32_t zigzagEncode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+inline void writeVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Never reads at or past end; false if the varint runs into it or is longer
+// than a uint32_t needs.
+inline bool readVarint(const uint8_t*& cursor, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && cursor < end; shift += 7) {
+        uint8_t byte = *cursor++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+
+// Records the player at a fixed sample rate while a round is played.
+class GhostRecorder {
+public:
+    void begin(uint32_t seed) {
+        track = GhostTrack();
+        track.seed = seed;
+        track.data.reserve(16 * 1024);
+        lastX = lastY = lastDY = 0;
+    }
+
+    // Call every frame with the round clock; adds however many samples are due.
+    void update(float gameTime, float x, float y, bool grounded) {
+        while (static_cast<float>(track.samples) <= gameTime * GHOST_SAMPLE_RATE) {
+            int32_t qx = static_cast<int32_t>(std::lround(x * GHOST_UNITS_PER_PIXEL));
+            int32_t qy = static_cast<int32_t>(std::lround(y * GHOST_UNITS_PER_PIXEL));
+            int32_t dy = qy - lastY;
+            writeVarint(track.data, zigzagEncode(dy - lastDY));
+            writeVarint(track.data, (zigzagEncode(qx - lastX) << 1) | (grounded ? 1u : 0u));
+            lastX = qx;
+            lastY = qy;
+            lastDY = dy;
+            track.samples++;
+        }
+    }
+
+    GhostTrack track;
+
+private:
+    int32_t lastX = 0, lastY = 0, lastDY = 0;
+};
+
+
+// Streams one track back, sample by sample, straight from its encoded bytes.
+struct GhostCursor {
+    const GhostTrack* track = nullptr;
+    const uint8_t* next = nullptr;
+    const uint8_t* end = nullptr;
+    uint32_t index = 0;         // samples decoded so far
+    int32_t x = 0, y = 0, dy = 0;
+    bool grounded = false;
+
+    void start(const GhostTrack& source) {
+        track = &source;
+        next = source.data.data();
+        end = next + source.data.size();
+        index = 0;
+        x = y = dy = 0;
+        grounded = false;
+    }
+
+    bool finished() const { return index >= track->samples; }
+
+    // False, leaving the position as it was, if the track's bytes run out.
+    bool step() {
+        uint32_t ddy, packed;
+        if (!readVarint(next, end, ddy) || !readVarint(next, end, packed)) return false;
+        dy += zigzagDecode(ddy);
+        y += dy;
+        x += zigzagDecode(packed >> 1);
+        grounded = (packed & 1) != 0;
+        index++;
+        return true;
+    }
+};
+
+
+// Best runs with their tracks, kept in "ghosts.bin" (best score first).
+// Saving happens on a background thread like the leaderboard's.
+class GhostLibrary {
+public:
+    GhostLibrary(const std::string& path, size_t capacity) : path(path), capacity(capacity) {
+        load();
+        writerThread = std::thread(&GhostLibrary::writerLoop, this);
+    }
+
+    ~GhostLibrary() {
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            stopWriter = true;
+        }
+        writerWake.notify_one();
+        if (writerThread.joinable()) writerThread.join();
+    }
+
+    GhostLibrary(const GhostLibrary&) = delete;
+    GhostLibrary& operator=(const GhostLibrary&) = delete;
+
+    const std::vector<GhostTrack>& tracks() const { return library; }
+
+    // Keeps the track if it is among the best `capacity` runs.
+    bool submit(const GhostTrack& track) {
+        if (track.samples == 0) return false;
+        auto it = std::upper_bound(library.begin(), library.end(), track,
+            [](const GhostTrack& a, const GhostTrack& b) { return a.score > b.score; });
+        if (static_cast<size_t>(it - library.begin()) >= capacity) return false;
+        library.insert(it, track);
+        if (library.size() > capacity) library.pop_back();
+
+        std::vector<char> image = serialise();
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            pendingImage.swap(image);
+            hasPending = true;
+        }
+        writerWake.notify_one();
+        return true;
+    }
+
+private:
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t count;
+    };
+
+    struct TrackHeader {
+        int32_t score;
+        uint32_t seed;
+        uint32_t samples;
+        uint32_t byteCount;
+    };
+
+    std::vector<char> serialise() const {
+        size_t size = sizeof(FileHeader);
+        for (const GhostTrack& track : library) size += sizeof(TrackHeader) + track.data.size();
+        std::vector<char> image(size);
+        FileHeader header;
+        std::memcpy(header.magic, "RRGH", 4);
+        header.version = GHOSTS_VERSION;
+        header.count = static_cast<uint32_t>(library.size());
+        char* out = image.data();
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        for (const GhostTrack& track : library) {
+            TrackHeader trackHeader = { track.score, track.seed, track.samples, static_cast<uint32_t>(track.data.size()) };
+            std::memcpy(out, &trackHeader, sizeof(trackHeader));
+            out += sizeof(trackHeader);
+            if (!track.data.empty()) std::memcpy(out, track.data.data(), track.data.size());
+            out += track.data.size();
+        }
+        return image;
+    }
+
+    void load() {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return;
+        std::vector<char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        FileHeader header;
+        if (image.size() < sizeof(header)) return;
+        std::memcpy(&header, image.data(), sizeof(header));
+        if (std::memcmp(header.magic, "RRGH", 4) != 0 || header.version != GHOSTS_VERSION) {
+            std::cerr << "Ignoring unreadable ghost file '" << path << "'" << std::endl;
+            return;
+        }
+        size_t offset = sizeof(header);
+        for (uint32_t i = 0; i < header.count && library.size() < capacity; i++) {
+            TrackHeader trackHeader;
+            if (offset + sizeof(trackHeader) > image.size()) break;
+            std::memcpy(&trackHeader, image.data() + offset, sizeof(trackHeader));
+            offset += sizeof(trackHeader);
+            if (offset + trackHeader.byteCount > image.size()) break;
+            GhostTrack track;
+            track.score = trackHeader.score;
+            track.seed = trackHeader.seed;
+            track.samples = trackHeader.samples;
+            track.data.assign(image.begin() + offset, image.begin() + offset + trackHeader.byteCount);
+            offset += trackHeader.byteCount;
+            // Decode it once so playback never runs past the bytes it was given.
+            GhostCursor cursor;
+            cursor.start(track);
+            while (!cursor.finished() && cursor.step()) {}
+            if (!cursor.finished()) {
+                std::cerr << "Ignoring corrupt ghost track " << i << " in '" << path << "'" << std::endl;
+                continue;
+            }
+            library.push_back(std::move(track));
+        }
+    }
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        while (true) {
+            writerWake.wait(lock, [this] { return hasPending || stopWriter; });
+            if (hasPending) {
+                std::vector<char> image;
+                image.swap(pendingImage);
+                hasPending = false;
+                lock.unlock();
+                if (!writeFileAtomically(path, image.data(), image.size())) {
+                    std::cerr << "Error writing ghosts '" << path << "'" << std::endl;
+                }
+                lock.lock();
+                continue;
+            }
+            if (stopWriter) break;
+        }
+    }
+
+    std::string path;
+    size_t capacity;
+    std::vector<GhostTrack> library;
+
+    std::thread writerThread;
+    std::mutex writerMutex;
+    std::condition_variable writerWake;
+    std::vector<char> pendingImage;
+    bool hasPending = false;
+    bool stopWriter = false;
+};
+
+
+// Plays back up to `capacity` ghosts as translucent rats, all in one draw
+// call: the idle and jump frames are packed into one atlas texture and every
+// ghost is two triangles in a single vertex array.
+class GhostRenderer {
+public:
+    bool init(const sf::Texture& idleTexture, const sf::Texture& jumpTexture, float width, float height, size_t capacity) {
+        sf::Image idle = idleTexture.copyToImage();
+        sf::Image jump = jumpTexture.copyToImage();
+        sf::Vector2u idleSize = idle.getSize();
+        sf::Vector2u jumpSize = jump.getSize();
+        sf::Image atlasImage;
+        atlasImage.create(idleSize.x + jumpSize.x, std::max(idleSize.y, jumpSize.y), sf::Color::Transparent);
+        atlasImage.copy(idle, 0, 0);
+        atlasImage.copy(jump, idleSize.x, 0);
+        if (!atlas.loadFromImage(atlasImage)) {
+            std::cerr << "Error building ghost texture atlas" << std::endl;
+            return false;
+        }
+        idleFrame = sf::FloatRect(0.f, 0.f, static_cast<float>(idleSize.x), static_cast<float>(idleSize.y));
+        jumpFrame = sf::FloatRect(static_cast<float>(idleSize.x), 0.f, static_cast<float>(jumpSize.x), static_cast<float>(jumpSize.y));
+        halfWidth = width / 2.f;
+        halfHeight = height / 2.f;
+        cursors.reserve(capacity);
+        vertices.setPrimitiveType(sf::Triangles);
+        vertices.resize(capacity * 6);
+        this->capacity = capacity;
+        return true;
+    }
+
+    // Starts every track from the beginning. The tracks must outlive playback.
+    void start(const std::vector<GhostTrack>& tracks) {
+        cursors.clear();
+        for (size_t i = 0; i < tracks.size() && i < capacity; i++) {
+            cursors.emplace_back();
+            cursors.back().start(tracks[i]);
+        }
+    }
+
+    void stop() { cursors.clear(); }
+
+    // Decodes up to gameTime and rebuilds the vertex array.
+    void update(float gameTime) {
+        uint32_t target = static_cast<uint32_t>(gameTime * GHOST_SAMPLE_RATE) + 1;
+        const sf::Color tint(255, 255, 255, 80);
+        visible = 0;
+        for (GhostCursor& cursor : cursors) {
+            while (cursor.index < target && !cursor.finished() && cursor.step()) {}
+            if (cursor.finished() && cursor.index < target) continue;   // that run had already ended
+
+            float x = cursor.x / GHOST_UNITS_PER_PIXEL;
+            float y = cursor.y / GHOST_UNITS_PER_PIXEL;
+            const sf::FloatRect& frame = cursor.grounded ? idleFrame : jumpFrame;
+            sf::Vertex* quad = &vertices[visible * 6];
+            sf::Vector2f topLeft(x - halfWidth, y - halfHeight), bottomRight(x + halfWidth, y + halfHeight);
+            sf::Vector2f uvTopLeft(frame.left, frame.top), uvBottomRight(frame.left + frame.width, frame.top + frame.height);
+            quad[0] = sf::Vertex(topLeft, tint, uvTopLeft);
+            quad[1] = sf::Vertex(sf::Vector2f(bottomRight.x, topLeft.y), tint, sf::Vector2f(uvBottomRight.x, uvTopLeft.y));
+            quad[2] = sf::Vertex(bottomRight, tint, uvBottomRight);
+            quad[3] = quad[0];
+            quad[4] = quad[2];
+            quad[5] = sf::Vertex(sf::Vector2f(topLeft.x, bottomRight.y), tint, sf::Vector2f(uvTopLeft.x, uvBottomRight.y));
+            visible++;
+        }
+    }
+
+    // One draw call for every ghost; false when there was nothing to draw.
+    bool draw(sf::RenderTarget& target) const {
+        if (visible == 0) return false;
+        sf::RenderStates states(&atlas);
+        target.draw(&vertices[0], visible * 6, sf::Triangles, states);
+        return true;
+    }
+
+    const sf::Texture& texture() const { return atlas; }
+
+private:
+    sf::Texture atlas;
+    sf::FloatRect idleFrame, jumpFrame;
+    float halfWidth = 30.f, halfHeight = 40.f;
+    size_t capacity = 0;
+    std::vector<GhostCursor> cursors;
+    sf::VertexArray vertices;
+    size_t visible = 0;
+};
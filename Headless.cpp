@@ -0,0 +1,107 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "GameSim.h"
+#include "Session.h"
+#include "Bot.h"
+
+// The game without a window: the same GameSim the SFML frontend runs,
+// driven from recorded sessions or by bots.
+//
+//  replay <session>...
+//      Plays each recording and checks it ends with the recorded score and
+//      state checksum; prints ticks per second. Fails if any run diverges.
+//  play <single|versus[N]> <seed> [ticks] [session to write] [tunables file]
+//      Bots play one round at 60 Hz until it ends or `ticks` have passed,
+//      N of them in versus (default 2, up to MAX_PLAYERS),
+//      optionally recording it for later replays. The tunables default to
+//      tunables.cfg; the recording keeps whichever were used.
+//
+// Usage: Headless replay <session>... | Headless play <single|versus[N]> <seed> [ticks] [out] [tunables]
+
+namespace {
+
+const float FRAME_DT = 1.f / 60.f;
+const float WINDOW_WIDTH = 1200.f;
+const float WINDOW_HEIGHT = 700.f;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int replay(int count, char** paths) {
+    int diverged = 0;
+    for (int i = 0; i < count; i++) {
+        SessionRecording session;
+        if (!loadSession(paths[i], session)) {
+            diverged++;
+            continue;
+        }
+        GameSim sim(session.tunables, session.windowWidth, session.windowHeight);
+        auto start = std::chrono::steady_clock::now();
+        bool matched = replaySession(sim, session);
+        double seconds = secondsSince(start);
+        if (!matched) diverged++;
+        std::cout << paths[i] << ": " << (session.mode == VersusMode ? "versus" : "single")
+                  << ", " << session.playerCount << (session.playerCount == 1 ? " player" : " players") << ", seed " << session.seed << ", " << session.ticks.size() << " ticks, score " << sim.score
+                  << ", " << sim.gameTime << "s, " << (matched ? "matches" : "DIVERGED")
+                  << ", " << static_cast<long>(session.ticks.size() / (seconds > 0.0 ? seconds : 1e-9)) << " ticks/s\n";
+    }
+    std::cout << std::flush;
+    return diverged == 0 ? 0 : 1;
+}
+
+int play(GameMode mode, int playerCount, uint32_t seed, int maxTicks, const std::string& outPath, const std::string& tunablesPath) {
+    Tunables tun = loadTunables(tunablesPath);
+    BotWorld botWorld = makeBotWorld(tun, PIXELS_PER_METER, WINDOW_HEIGHT);
+    GameSim sim(tun, WINDOW_WIDTH, WINDOW_HEIGHT);
+    std::vector<JumpBot> bots(MAX_PLAYERS, JumpBot(200));
+    BotObservation observation;
+    PlayerInput inputs[MAX_PLAYERS];
+    SessionRecorder recorder;
+
+    sim.startRound(mode, seed, playerCount);
+    recorder.begin(sim);
+    auto start = std::chrono::steady_clock::now();
+    int ticks = 0;
+    while (!sim.roundOver && ticks < maxTicks) {
+        for (int p = 0; p < sim.playerCount; p++) {
+            inputs[p] = PlayerInput();
+            if (!sim.players[p].body) continue;
+            sim.observe(p, observation);
+            inputs[p] = bots[p].think(observation, botWorld);
+        }
+        sim.tick(FRAME_DT, inputs);
+        recorder.record(FRAME_DT, inputs);
+        ticks++;
+    }
+    double seconds = secondsSince(start);
+    const SessionRecording& session = recorder.finish(sim);
+
+    std::cout << (mode == VersusMode ? "versus" : "single") << ", " << sim.playerCount
+              << (sim.playerCount == 1 ? " player" : " players") << ", seed " << seed << ": " << ticks << " ticks, score "
+              << sim.score << ", " << sim.gameTime << "s" << (sim.roundOver ? "" : " (not finished)")
+              << ", " << static_cast<long>(ticks / (seconds > 0.0 ? seconds : 1e-9)) << " ticks/s" << std::endl;
+    if (!outPath.empty() && !saveSession(outPath, session)) return 1;
+    return 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "replay" && argc > 2) return replay(argc - 2, argv + 2);
+    if (command == "play" && argc > 3) {
+        std::string mode = argv[2];
+        bool versus = mode.compare(0, 6, "versus") == 0;
+        if (mode == "single" || versus) {
+            int playerCount = (versus && mode.size() > 6) ? std::atoi(mode.c_str() + 6) : 2;
+            return play(versus ? VersusMode : SinglePlayerMode, playerCount, static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)),
+                        argc > 4 ? std::atoi(argv[4]) : 60 * 60 * 5, argc > 5 ? argv[5] : "", argc > 6 ? argv[6] : "tunables.cfg");
+        }
+    }
+    std::cerr << "Usage: Headless replay <session>... | Headless play <single|versus[N]> <seed> [ticks] [out] [tunables]" << std::endl;
+    return 2;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <charconv>
+#include "Trace.h"
+
+
+// A labelled number on the HUD: the label on one line and the value under
+// it, indented, as "Score \n  <value>" used to be laid out by one sf::Text.
+// The label is an sf::Text set once, so its geometry is built once and only
+// redrawn. The value is drawn from the font's digit glyphs, looked up when
+// the counter is set up: a new value is formatted with std::to_chars into a
+// fixed buffer and turned into quads in a fixed vertex array, so changing it
+// neither allocates nor lays out text, and setting the value it already
+// shows does nothing.
+class HudCounter {
+public:
+    void init(const sf::Font& font, unsigned int characterSize, const sf::String& labelString,
+              sf::Vector2f position, int indentSpaces, sf::Color color) {
+        this->font = &font;
+        this->characterSize = characterSize;
+        this->color = color;
+        label.setFont(font);
+        label.setCharacterSize(characterSize);
+        label.setString(labelString);
+        label.setFillColor(color);
+        label.setPosition(position);
+
+        // Where sf::Text would put the second line's baseline and the first
+        // character after the indent.
+        origin.x = position.x + indentSpaces * font.getGlyph(U' ', characterSize, false).advance;
+        origin.y = position.y + static_cast<float>(characterSize) + font.getLineSpacing(characterSize);
+        for (int d = 0; d < 10; d++) digitGlyphs[d] = font.getGlyph(U'0' + d, characterSize, false);
+        minusGlyph = font.getGlyph(U'-', characterSize, false);
+        shown = false;
+    }
+
+    void set(int value) {
+        if (shown && value == shownValue) return;
+        TraceScope traceHud("hud text");
+        char digits[MAX_CHARS];
+        std::to_chars_result result = std::to_chars(digits, digits + MAX_CHARS, value);
+        int length = static_cast<int>(result.ptr - digits);
+
+        float x = origin.x;
+        vertexCount = 0;
+        for (int i = 0; i < length; i++) {
+            if (i > 0) x += font->getKerning(static_cast<sf::Uint32>(digits[i - 1]), static_cast<sf::Uint32>(digits[i]), characterSize);
+            const sf::Glyph& glyph = (digits[i] == '-') ? minusGlyph : digitGlyphs[digits[i] - '0'];
+            putGlyph(glyph, x);
+            x += glyph.advance;
+        }
+        shownValue = value;
+        shown = true;
+    }
+
+    const sf::Text& labelText() const { return label; }
+
+    // One draw call for the value; false before the first set().
+    bool drawValue(sf::RenderTarget& target) const {
+        if (vertexCount == 0) return false;
+        target.draw(vertices, vertexCount, sf::Triangles, sf::RenderStates(&font->getTexture(characterSize)));
+        return true;
+    }
+
+    const sf::Texture& texture() const { return font->getTexture(characterSize); }
+
+private:
+    static const int MAX_CHARS = 12;    // "-2147483648" and then some
+
+    // The same quad sf::Text makes for a glyph, padding included.
+    void putGlyph(const sf::Glyph& glyph, float x) {
+        const float padding = 1.f;
+        float left = x + glyph.bounds.left - padding;
+        float top = origin.y + glyph.bounds.top - padding;
+        float right = x + glyph.bounds.left + glyph.bounds.width + padding;
+        float bottom = origin.y + glyph.bounds.top + glyph.bounds.height + padding;
+        float u1 = static_cast<float>(glyph.textureRect.left) - padding;
+        float v1 = static_cast<float>(glyph.textureRect.top) - padding;
+        float u2 = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width) + padding;
+        float v2 = static_cast<float>(glyph.textureRect.top + glyph.textureRect.height) + padding;
+
+        sf::Vertex* quad = &vertices[vertexCount];
+        quad[0] = sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(u1, v1));
+        quad[1] = sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1));
+        quad[2] = sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(u2, v2));
+        quad[3] = quad[0];
+        quad[4] = quad[2];
+        quad[5] = sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2));
+        vertexCount += 6;
+    }
+
+    const sf::Font* font = nullptr;
+    unsigned int characterSize = 30;
+    sf::Color color = sf::Color::White;
+    sf::Text label;
+    sf::Vector2f origin;        // baseline start of the value
+    sf::Glyph digitGlyphs[10];
+    sf::Glyph minusGlyph;
+    sf::Vertex vertices[MAX_CHARS * 6];
+    size_t vertexCount = 0;
+    int shownValue = 0;
+    bool shown = false;
+};
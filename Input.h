@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include "GameSim.h"
+
+
+enum InputAction : uint8_t { ActionJump, ActionFastFallDown, ActionFastFallUp };
+
+// Key transitions in the order they happened, each stamped with when it was
+// seen, handed to the fixed-step simulation one tick at a time. Each tick
+// covers a span of wall time, and a transition goes to the tick whose span
+// it falls in, however the ticks are spread over frames. A press in a frame
+// that runs no tick waits for the next tick instead of being lost or
+// repeated, and a press made after the last tick of a frame began goes to
+// the tick after it. The simulation only ever sees the per-tick
+// PlayerInputs, so recording those is enough to replay a round exactly.
+class InputTimeline {
+public:
+    static const int CAPACITY = 64;
+
+    void clear() {
+        count = 0;
+        dropped = 0;
+        for (bool& held : fastFallHeld) held = false;
+    }
+
+    // Timestamps must not go backwards. Transitions beyond CAPACITY that
+    // no tick has taken yet are dropped and counted.
+    void push(int player, InputAction action, int64_t micros) {
+        if (count == CAPACITY) {
+            dropped++;
+            return;
+        }
+        pending[count++] = Transition{ micros, static_cast<uint8_t>(player), action };
+    }
+
+    // The inputs for the tick ending at endMicros: jump if a press landed
+    // in it, fast-fall if the key was held at any point of it. Nothing is
+    // consumed, so a tick that cannot run yet (a network stall) can ask again.
+    void inputsFor(int64_t endMicros, PlayerInput* inputs) const {
+        for (int p = 0; p < MAX_PLAYERS; p++) {
+            inputs[p] = PlayerInput();
+            inputs[p].fastFall = fastFallHeld[p];
+        }
+        for (int i = 0; i < count && pending[i].micros <= endMicros; i++) {
+            PlayerInput& input = inputs[pending[i].player];
+            if (pending[i].action == ActionJump) input.jumpPressed = true;
+            else if (pending[i].action == ActionFastFallDown) input.fastFall = true;
+        }
+    }
+
+    // Drops the transitions up to endMicros once their tick has run.
+    // Returns the timestamp of the earliest press among them, or -1, for
+    // measuring input-to-photon latency.
+    int64_t consume(int64_t endMicros) {
+        int taken = 0;
+        int64_t earliestPress = -1;
+        while (taken < count && pending[taken].micros <= endMicros) {
+            const Transition& transition = pending[taken++];
+            if (transition.action == ActionFastFallDown) fastFallHeld[transition.player] = true;
+            else if (transition.action == ActionFastFallUp) fastFallHeld[transition.player] = false;
+            if (transition.action != ActionFastFallUp && earliestPress < 0) earliestPress = transition.micros;
+        }
+        for (int i = taken; i < count; i++) pending[i - taken] = pending[i];
+        count -= taken;
+        return earliestPress;
+    }
+
+    uint64_t droppedCount() const { return dropped; }
+
+private:
+    struct Transition {
+        int64_t micros;
+        uint8_t player;
+        InputAction action;
+    };
+
+    Transition pending[CAPACITY];
+    int count = 0;
+    bool fastFallHeld[MAX_PLAYERS] = {};
+    uint64_t dropped = 0;
+};
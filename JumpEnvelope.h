@@ -0,0 +1,203 @@
+#pragma once
+
+#include "Tunables.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+// Closed-form model of where the player can get to from a platform.
+//
+// Coordinates are pixels with y pointing down, like the rest of the game.
+// Heights passed in are platform centre y values; the player stands
+// fixedHeight / 2 + playerHeight / 2 above that, so differences between
+// platforms carry over directly.
+//
+// Model:
+// - A jump adds jumpSpeed upwards; gravity pulls down at `gravity`.
+// - Jumps are chained at the apex of the previous hop. Under the ceiling,
+//   a later hop is taken after a short dip so it just touches the ceiling
+//   again, which adds jumpSpeed / gravity of air time per jump.
+// - Hitting the ceiling kills upward speed.
+// - Holding fast-fall multiplies gravity by fastFallScale, so the player
+//   can drop onto a lower platform almost immediately.
+// - Platforms move left at blockSpeed and the player's x is fixed, so
+//   horizontal distance is just time.
+struct JumpParams {
+    float jumpSpeed = 500.f;        // px/s added by one jump
+    float gravity = 350.f;          // px/s^2
+    int maxJumps = 2;
+    float fastFallScale = 100.f;
+    float blockSpeed = 200.f;       // px/s
+    float ceilingOffset = 90.f;     // a platform at y has y - ceilingOffset of headroom
+    float footWidth = 54.f;         // px of the player that must overlap a platform to stand on it
+};
+
+inline JumpParams makeJumpParams(const Tunables& tun, float pixelsPerMeter, float blockSpeed, float ceilingBottomY = 0.f) {
+    JumpParams params;
+    params.jumpSpeed = tun.playerJumpForce;
+    params.gravity = tun.gravity * pixelsPerMeter;
+    params.maxJumps = tun.maxJumps;
+    params.fastFallScale = std::max(1.f, tun.fastFallGravityScale);
+    params.blockSpeed = blockSpeed;
+    params.ceilingOffset = ceilingBottomY + tun.fixedHeight / 2.f + tun.playerHeight;
+    params.footWidth = tun.playerWidth * 0.9f;
+    return params;
+}
+
+
+// Everything about a launch platform that does not depend on the target.
+struct JumpEnvelope {
+    JumpParams params;
+    float headroom = 0.f;       // px between standing height and the ceiling
+    float maxRise = 0.f;        // highest point reachable above the launch platform
+    float timeToApex = 0.f;     // seconds to get there with every jump used
+    float hopHeight = 0.f;      // rise of one unobstructed jump
+    float hopTime = 0.f;        // seconds to the apex of one unobstructed jump
+
+    // Latest time after take-off the player can still be above a platform
+    // `rise` pixels above the launch platform (negative rise = lower).
+    float latestLanding(float rise) const {
+        if (rise > maxRise) return -1.f;
+        return timeToApex + std::sqrt(2.f * (maxRise - rise) / params.gravity);
+    }
+
+    // Earliest time after take-off the player can be standing on it.
+    float earliestLanding(float rise) const {
+        if (rise > maxRise) return -1.f;
+        if (rise <= 0.f) return std::sqrt(-2.f * rise / (params.gravity * params.fastFallScale));
+        float fullHops = std::min(std::floor(rise / hopHeight), static_cast<float>(params.maxJumps - 1));
+        float partial = rise - fullHops * hopHeight;
+        float v = params.jumpSpeed;
+        return fullHops * hopTime + (v - std::sqrt(std::max(0.f, v * v - 2.f * params.gravity * partial))) / params.gravity;
+    }
+
+    // Widest gap (px between the launch platform's trailing edge and the
+    // target's leading edge) that can still be crossed to a target `rise` up.
+    float maxGap(float rise) const {
+        float latest = latestLanding(rise);
+        return latest < 0.f ? -1.f : latest * params.blockSpeed + params.footWidth;
+    }
+
+    // Is a target platform reachable? `launchLength` is how much of the
+    // launch platform is still ahead of the player when they start to plan.
+    bool reachable(float launchLength, float gap, float rise, float targetLength) const;
+};
+
+inline JumpEnvelope computeJumpEnvelope(const JumpParams& params, float launchY) {
+    JumpEnvelope envelope;
+    envelope.params = params;
+    float v = params.jumpSpeed;
+    float g = params.gravity;
+    envelope.hopHeight = v * v / (2.f * g);
+    envelope.hopTime = v / g;
+    envelope.headroom = std::max(0.f, launchY - params.ceilingOffset);
+
+    float height = 0.f;
+    float time = 0.f;
+    for (int jump = 0; jump < params.maxJumps; jump++) {
+        float room = envelope.headroom - height;
+        if (room >= envelope.hopHeight) {
+            height += envelope.hopHeight;
+            time += envelope.hopTime;
+        } else if (room > 0.f) {
+            time += (v - std::sqrt(v * v - 2.f * g * room)) / g;
+            height = envelope.headroom;
+        } else {
+            // Dip by a quarter hop, then jump back up to the ceiling.
+            time += envelope.hopTime;
+        }
+    }
+    envelope.maxRise = height;
+    envelope.timeToApex = time;
+    return envelope;
+}
+
+
+// Batch form of JumpEnvelope::reachable for many targets from one launch
+// platform. Inputs are structure-of-arrays; out[i] is 1 if target i is
+// reachable. Four targets are evaluated per step with SSE2 (baseline on
+// x86-64); the remainder, and other architectures, use the scalar loop.
+inline void evaluateReachability(const JumpEnvelope& envelope, float launchLength,
+                                 const float* gap, const float* rise,
+                                 const float* targetLength, uint8_t* out, size_t count) {
+    const float g = envelope.params.gravity;
+    const float v = envelope.params.jumpSpeed;
+    const float speed = std::max(envelope.params.blockSpeed, 1.f);
+    const float invSpeed = 1.f / speed;
+    const float foot = envelope.params.footWidth;
+    const float maxRise = envelope.maxRise;
+    const float timeToApex = envelope.timeToApex;
+    const float hopHeight = envelope.hopHeight;
+    const float hopTime = envelope.hopTime;
+    const float lastHop = static_cast<float>(envelope.params.maxJumps - 1);
+    const float lead = launchLength * invSpeed;
+    const float invG = 1.f / g;
+    const float invHopHeight = 1.f / hopHeight;
+    const float twoOverG = 2.f / g;
+    const float twoOverFastFallG = 2.f / (g * envelope.params.fastFallScale);
+    const float vSquared = v * v;
+    const float twoG = 2.f * g;
+
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 r = _mm_loadu_ps(rise + i);
+        __m128 up = _mm_max_ps(r, zero);
+        __m128 down = _mm_max_ps(_mm_sub_ps(zero, r), zero);
+        __m128 above = _mm_max_ps(_mm_sub_ps(_mm_set1_ps(maxRise), r), zero);
+        __m128 latest = _mm_add_ps(_mm_set1_ps(timeToApex), _mm_sqrt_ps(_mm_mul_ps(above, _mm_set1_ps(twoOverG))));
+
+        // up is never negative, so truncation is floor.
+        __m128 fullHops = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(up, _mm_set1_ps(invHopHeight))));
+        fullHops = _mm_min_ps(fullHops, _mm_set1_ps(lastHop));
+        __m128 partial = _mm_sub_ps(up, _mm_mul_ps(fullHops, _mm_set1_ps(hopHeight)));
+        __m128 climbSpeed2 = _mm_max_ps(_mm_sub_ps(_mm_set1_ps(vSquared), _mm_mul_ps(_mm_set1_ps(twoG), partial)), zero);
+        __m128 climb = _mm_add_ps(_mm_mul_ps(fullHops, _mm_set1_ps(hopTime)),
+                                  _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(v), _mm_sqrt_ps(climbSpeed2)), _mm_set1_ps(invG)));
+        __m128 drop = _mm_sqrt_ps(_mm_mul_ps(down, _mm_set1_ps(twoOverFastFallG)));
+        __m128 rising = _mm_cmpgt_ps(r, zero);
+        __m128 earliest = _mm_or_ps(_mm_and_ps(rising, climb), _mm_andnot_ps(rising, drop));
+
+        __m128 gaps = _mm_loadu_ps(gap + i);
+        __m128 arrive = _mm_mul_ps(_mm_sub_ps(gaps, _mm_set1_ps(foot)), _mm_set1_ps(invSpeed));
+        __m128 depart = _mm_mul_ps(_mm_add_ps(gaps, _mm_loadu_ps(targetLength + i)), _mm_set1_ps(invSpeed));
+        __m128 ok = _mm_and_ps(_mm_cmple_ps(r, _mm_set1_ps(maxRise)),
+                    _mm_and_ps(_mm_cmpge_ps(latest, arrive),
+                               _mm_cmple_ps(_mm_sub_ps(earliest, _mm_set1_ps(lead)), depart)));
+        int mask = _mm_movemask_ps(ok);
+        out[i] = static_cast<uint8_t>(mask & 1);
+        out[i + 1] = static_cast<uint8_t>((mask >> 1) & 1);
+        out[i + 2] = static_cast<uint8_t>((mask >> 2) & 1);
+        out[i + 3] = static_cast<uint8_t>((mask >> 3) & 1);
+    }
+#endif
+    for (; i < count; i++) {
+        float r = rise[i];
+        float up = std::max(r, 0.f);
+        float down = std::max(-r, 0.f);
+        float latest = timeToApex + std::sqrt(std::max(maxRise - r, 0.f) * twoOverG);
+
+        float fullHops = std::min(std::floor(up * invHopHeight), lastHop);
+        float partial = up - fullHops * hopHeight;
+        float climb = fullHops * hopTime + (v - std::sqrt(std::max(vSquared - twoG * partial, 0.f))) * invG;
+        float drop = std::sqrt(down * twoOverFastFallG);
+        float earliest = r > 0.f ? climb : drop;
+
+        float arrive = (gap[i] - foot) * invSpeed;
+        float depart = (gap[i] + targetLength[i]) * invSpeed;
+        out[i] = static_cast<uint8_t>(r <= maxRise && latest >= arrive && earliest - lead <= depart);
+    }
+}
+
+
+inline bool JumpEnvelope::reachable(float launchLength, float gap, float rise, float targetLength) const {
+    uint8_t result = 0;
+    evaluateReachability(*this, launchLength, &gap, &rise, &targetLength, &result, 1);
+    return result != 0;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include "AtomicFile.h"
+
+
+struct LeaderboardEntry {
+    int32_t score = 0;
+    float timeSeconds = 0.f;
+    uint32_t seed = 0;
+    uint32_t reserved = 0;
+    int64_t date = 0; // seconds since the Unix epoch
+};
+
+struct LeaderboardFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entrySize;
+    uint32_t count;
+};
+
+static constexpr uint32_t LEADERBOARD_VERSION = 1;
+
+
+// Top-N table of single-player runs, stored as a fixed-layout binary file.
+// The file is mapped once at startup; after that every read comes from the
+// in-memory table. submit() only inserts into that table and hands a copy to
+// a background thread, which replaces the file with writeFileAtomically().
+class Leaderboard {
+public:
+    Leaderboard(const std::string& path, size_t capacity, const std::string& legacyHighScorePath = "")
+        : path(path), capacity(capacity) {
+        if (!loadFile()) {
+            importLegacyHighScore(legacyHighScorePath);
+        }
+        writerThread = std::thread(&Leaderboard::writerLoop, this);
+    }
+
+    ~Leaderboard() {
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            stopWriter = true;
+        }
+        writerWake.notify_one();
+        if (writerThread.joinable()) writerThread.join();
+    }
+
+    Leaderboard(const Leaderboard&) = delete;
+    Leaderboard& operator=(const Leaderboard&) = delete;
+
+    const std::vector<LeaderboardEntry>& entries() const { return table; }
+
+    int bestScore() const { return table.empty() ? 0 : table.front().score; }
+
+    // Returns the 1-based rank the run earned, or 0 if it did not make the table.
+    int submit(const LeaderboardEntry& entry) {
+        auto it = std::upper_bound(table.begin(), table.end(), entry,
+            [](const LeaderboardEntry& a, const LeaderboardEntry& b) { return a.score > b.score; });
+        size_t rank = static_cast<size_t>(it - table.begin());
+        if (rank >= capacity) return 0;
+        table.insert(it, entry);
+        if (table.size() > capacity) table.pop_back();
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            pendingTable = table;
+            hasPending = true;
+        }
+        writerWake.notify_one();
+        return static_cast<int>(rank) + 1;
+    }
+
+private:
+    bool loadFile() {
+#ifdef RAT_RIDER_POSIX_IO
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(LeaderboardFileHeader))) {
+            close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+        bool ok = readImage(static_cast<const char*>(mapped), size);
+        munmap(mapped, size);
+        return ok;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+        std::vector<char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return readImage(image.data(), image.size());
+#endif
+    }
+
+    bool readImage(const char* data, size_t size) {
+        LeaderboardFileHeader header;
+        if (size < sizeof(header)) {
+            std::cerr << "Ignoring unreadable leaderboard file '" << path << "'" << std::endl;
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, "RRLB", 4) != 0 || header.version != LEADERBOARD_VERSION ||
+            header.entrySize != sizeof(LeaderboardEntry) ||
+            size < sizeof(header) + static_cast<size_t>(header.count) * sizeof(LeaderboardEntry)) {
+            std::cerr << "Ignoring unreadable leaderboard file '" << path << "'" << std::endl;
+            return false;
+        }
+        size_t count = std::min<size_t>(header.count, capacity);
+        table.resize(count);
+        std::memcpy(table.data(), data + sizeof(header), count * sizeof(LeaderboardEntry));
+        return true;
+    }
+
+    // One-time migration from the old single-integer highscore.txt.
+    void importLegacyHighScore(const std::string& legacyPath) {
+        if (legacyPath.empty()) return;
+        std::ifstream file(legacyPath);
+        int highscore = 0;
+        if (file.is_open() && (file >> highscore) && highscore > 0) {
+            LeaderboardEntry entry;
+            entry.score = highscore;
+            submit(entry);
+        }
+    }
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(writerMutex);
+        while (true) {
+            writerWake.wait(lock, [this] { return hasPending || stopWriter; });
+            if (hasPending) {
+                std::vector<LeaderboardEntry> snapshot;
+                snapshot.swap(pendingTable);
+                hasPending = false;
+                lock.unlock();
+                writeAtomically(snapshot);
+                lock.lock();
+                continue;
+            }
+            if (stopWriter) break;
+        }
+    }
+
+    void writeAtomically(const std::vector<LeaderboardEntry>& snapshot) const {
+        LeaderboardFileHeader header;
+        std::memcpy(header.magic, "RRLB", 4);
+        header.version = LEADERBOARD_VERSION;
+        header.entrySize = sizeof(LeaderboardEntry);
+        header.count = static_cast<uint32_t>(snapshot.size());
+
+        std::vector<char> image(sizeof(header) + snapshot.size() * sizeof(LeaderboardEntry));
+        std::memcpy(image.data(), &header, sizeof(header));
+        if (!snapshot.empty()) {
+            std::memcpy(image.data() + sizeof(header), snapshot.data(), snapshot.size() * sizeof(LeaderboardEntry));
+        }
+
+        if (!writeFileAtomically(path, image.data(), image.size())) {
+            std::cerr << "Error writing leaderboard '" << path << "'" << std::endl;
+        }
+    }
+
+    std::string path;
+    size_t capacity;
+    std::vector<LeaderboardEntry> table;
+
+    std::thread writerThread;
+    std::mutex writerMutex;
+    std::condition_variable writerWake;
+    std::vector<LeaderboardEntry> pendingTable;
+    bool hasPending = false;
+    bool stopWriter = false;
+};
@@ -0,0 +1,464 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include "GameSim.h"
+#include "Bot.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define RAT_RIDER_POSIX_NET 1
+#endif
+
+
+static constexpr size_t NET_MAX_PACKET = 128;
+static constexpr float NET_TICK = 1.f / 60.f;
+
+
+// Artificial delay and loss applied to outgoing packets, for testing on loopback.
+struct LinkConditions {
+    float latencyMs = 0.f;      // one way
+    float jitterMs = 0.f;       // added uniformly on top of latency, so packets can reorder
+    float lossRate = 0.f;       // 0..1
+};
+
+
+// Non-blocking UDP socket bound to a local port and talking to one remote
+// address. Packets from anyone else are ignored.
+class UdpLink {
+public:
+    UdpLink() = default;
+    ~UdpLink() { close(); }
+
+    UdpLink(const UdpLink&) = delete;
+    UdpLink& operator=(const UdpLink&) = delete;
+
+    bool open(uint16_t localPort, const std::string& remoteHost, uint16_t remotePort) {
+#ifdef RAT_RIDER_POSIX_NET
+        close();
+        addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* resolved = nullptr;
+        if (getaddrinfo(remoteHost.c_str(), std::to_string(remotePort).c_str(), &hints, &resolved) != 0 || !resolved) {
+            std::cerr << "Error resolving '" << remoteHost << "'" << std::endl;
+            return false;
+        }
+        std::memcpy(&remote, resolved->ai_addr, sizeof(remote));
+        freeaddrinfo(resolved);
+
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            std::cerr << "Error creating UDP socket" << std::endl;
+            return false;
+        }
+        sockaddr_in local;
+        std::memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(localPort);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+            std::cerr << "Error binding UDP port " << localPort << std::endl;
+            close();
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        return true;
+#else
+        (void)localPort; (void)remoteHost; (void)remotePort;
+        std::cerr << "Error: network play needs POSIX sockets" << std::endl;
+        return false;
+#endif
+    }
+
+    void close() {
+#ifdef RAT_RIDER_POSIX_NET
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        delayed.clear();
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    void setConditions(const LinkConditions& newConditions, uint32_t seed) {
+        conditions = newConditions;
+        rng.seed(seed);
+    }
+
+    // Sends now, or holds the packet until `now` passes its delivery time
+    // when latency is configured. Lost packets are counted and dropped.
+    void send(const uint8_t* data, size_t size, double now) {
+        if (size > NET_MAX_PACKET) return;
+        packetsSent++;
+        if (conditions.lossRate > 0.f && std::uniform_real_distribution<float>(0.f, 1.f)(rng) < conditions.lossRate) {
+            packetsDropped++;
+            return;
+        }
+        if (conditions.latencyMs <= 0.f && conditions.jitterMs <= 0.f) {
+            sendNow(data, size);
+            return;
+        }
+        DelayedPacket packet;
+        float jitter = conditions.jitterMs > 0.f ? std::uniform_real_distribution<float>(0.f, conditions.jitterMs)(rng) : 0.f;
+        packet.releaseTime = now + (conditions.latencyMs + jitter) / 1000.0;
+        packet.size = size;
+        std::memcpy(packet.data, data, size);
+        delayed.push_back(packet);
+    }
+
+    // Sends every held packet whose delivery time has passed.
+    void flush(double now) {
+        size_t kept = 0;
+        for (size_t i = 0; i < delayed.size(); i++) {
+            if (delayed[i].releaseTime <= now) sendNow(delayed[i].data, delayed[i].size);
+            else delayed[kept++] = delayed[i];
+        }
+        delayed.resize(kept);
+    }
+
+    // Returns false when nothing is waiting.
+    bool receive(uint8_t* buffer, size_t& size) {
+#ifdef RAT_RIDER_POSIX_NET
+        while (fd >= 0) {
+            sockaddr_in from;
+            socklen_t fromLength = sizeof(from);
+            ssize_t n = recvfrom(fd, buffer, NET_MAX_PACKET, 0, reinterpret_cast<sockaddr*>(&from), &fromLength);
+            if (n < 0) return false;
+            if (from.sin_addr.s_addr != remote.sin_addr.s_addr || from.sin_port != remote.sin_port) continue;
+            size = static_cast<size_t>(n);
+            packetsReceived++;
+            return true;
+        }
+#else
+        (void)buffer; (void)size;
+#endif
+        return false;
+    }
+
+    // Drops held packets and anything already queued on the socket.
+    void drain() {
+        delayed.clear();
+        uint8_t buffer[NET_MAX_PACKET];
+        size_t size;
+        while (receive(buffer, size)) {}
+    }
+
+    uint64_t packetsSent = 0;
+    uint64_t packetsDropped = 0;
+    uint64_t packetsReceived = 0;
+
+private:
+    struct DelayedPacket {
+        double releaseTime = 0.0;
+        size_t size = 0;
+        uint8_t data[NET_MAX_PACKET];
+    };
+
+    void sendNow(const uint8_t* data, size_t size) {
+#ifdef RAT_RIDER_POSIX_NET
+        if (fd >= 0) sendto(fd, data, size, 0, reinterpret_cast<const sockaddr*>(&remote), sizeof(remote));
+#else
+        (void)data; (void)size;
+#endif
+    }
+
+    int fd = -1;
+#ifdef RAT_RIDER_POSIX_NET
+    sockaddr_in remote;
+#endif
+    LinkConditions conditions;
+    std::mt19937 rng;
+    std::vector<DelayedPacket> delayed;
+};
+
+
+struct RollbackStats {
+    uint64_t framesAdvanced = 0;
+    uint64_t rollbacks = 0;
+    uint64_t framesResimulated = 0;
+    int maxRollbackDepth = 0;
+    uint64_t stalls = 0;            // advance() calls refused because the remote player was too far behind
+    double lastAdvanceMs = 0.0;
+    double maxAdvanceMs = 0.0;
+};
+
+
+// GGPO-style rollback for a two-player versus round. Both peers run the same
+// GameSim; each sends its own inputs for every frame and simulates ahead with
+// a prediction of the other's (the last input received, without the jump
+// edge). When a real input arrives that differs from what a frame was
+// simulated with, the session loads the snapshot from before that frame and
+// re-simulates up to the present, all inside one advance().
+//
+// Every frame, predicted or not, starts with GameSim::loadState() of the
+// snapshot before it. loadState() rebuilds the Box2D world from scratch, so a
+// frame's result depends only on that snapshot and the two inputs, whichever
+// peer runs it and however often it was rolled back.
+//
+// Packets: "RRNP", type, then
+//   Sync:  slot, seed, whether we have heard from the peer
+//   Input: highest remote frame received, first frame, count, one input byte per frame
+// Inputs are resent until acknowledged, so a lost packet costs nothing but latency.
+class RollbackSession {
+public:
+    static constexpr int FRAME_WINDOW = 256;
+    static constexpr int MAX_INPUTS_PER_PACKET = 64;
+
+    RollbackSession(GameSim& sim, UdpLink& link, int localSlot, int maxRollback = 8, int inputDelay = 2)
+        : sim(sim), link(link), localSlot(localSlot), maxRollback(maxRollback), inputDelay(inputDelay),
+          snapshots(maxRollback + 2) {}
+
+    // Handshake. Call once per frame until it returns true; the round then
+    // uses player 1's proposed seed on both sides.
+    bool synchronise(uint32_t proposedSeed, double now) {
+        if (!seedProposed) {
+            localSeed = proposedSeed;
+            seedProposed = true;
+        }
+        link.flush(now);
+        pollNetwork(now);
+        sendSync(now);
+        return remoteSeen && remoteHeardUs;
+    }
+
+    void start() {
+        seed = (localSlot == 0) ? localSeed : remoteSeed;
+        sim.startRound(VersusMode, seed);
+        currentFrame = 0;
+        started = true;
+        lastRemoteFrame = -1;
+        lastLocalFrame = inputDelay - 1;
+        remoteAck = -1;
+        firstMispredicted = -1;
+        std::memset(localInputs, 0, sizeof(localInputs));
+        std::memset(remoteInputs, 0, sizeof(remoteInputs));
+        std::memset(usedRemoteInputs, 0, sizeof(usedRemoteInputs));
+        sim.saveState(snapshots[0]);
+        checksums[0] = sim.stateChecksum();
+        roundOverAt[0] = sim.roundOver;
+    }
+
+    // Simulates one NET_TICK with the local player's input. Returns false
+    // without simulating when running ahead would exceed the rollback window;
+    // the caller should hand the same input in again next time.
+    bool advance(const PlayerInput& local, double now) {
+        auto begin = std::chrono::steady_clock::now();
+        link.flush(now);
+        pollNetwork(now);
+
+        if (currentFrame + 1 - (lastRemoteFrame + 1) > maxRollback) {
+            stats.stalls++;
+            sendInputs(now);
+            return false;
+        }
+
+        int inputFrame = currentFrame + inputDelay;
+        localInputs[inputFrame % FRAME_WINDOW] = packInput(local);
+        lastLocalFrame = inputFrame;
+        sendInputs(now);
+
+        if (firstMispredicted >= 0) {
+            int depth = currentFrame - firstMispredicted;
+            stats.rollbacks++;
+            stats.framesResimulated += static_cast<uint64_t>(depth);
+            stats.maxRollbackDepth = std::max(stats.maxRollbackDepth, depth);
+            for (int frame = firstMispredicted; frame < currentFrame; frame++) simulateFrame(frame);
+            firstMispredicted = -1;
+        }
+        simulateFrame(currentFrame);
+        currentFrame++;
+        stats.framesAdvanced++;
+
+        stats.lastAdvanceMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        stats.maxAdvanceMs = std::max(stats.maxAdvanceMs, stats.lastAdvanceMs);
+        return true;
+    }
+
+    bool isStarted() const { return started; }
+    int frame() const { return currentFrame; }
+    uint32_t roundSeed() const { return seed; }
+    int slot() const { return localSlot; }
+
+    // Latest frame whose state both peers agree on: everything before it was
+    // simulated with real inputs from both sides.
+    int confirmedFrame() const { return std::min(lastRemoteFrame + 1, currentFrame); }
+
+    // True once the round has ended in a confirmed frame. A round that only
+    // ends under a prediction may still be rolled back.
+    bool roundFinished() const {
+        return started && roundOverAt[confirmedFrame() % FRAME_WINDOW];
+    }
+
+    // True once the round has finished here and the peer has acknowledged
+    // every local input up to the frame it ended in, so the peer can confirm
+    // the ending without hearing from us again.
+    bool peerConfirmedEnding() const {
+        if (!roundFinished()) return false;
+        int endFrame = confirmedFrame();
+        while (endFrame > 0 && endFrame > currentFrame - FRAME_WINDOW + 1 && roundOverAt[(endFrame - 1) % FRAME_WINDOW]) endFrame--;
+        return remoteAck + 1 >= endFrame;
+    }
+
+    // Checksum of the state at the start of a confirmed frame still in the window.
+    bool confirmedChecksum(int frame, uint64_t& out) const {
+        if (frame > confirmedFrame() || frame <= currentFrame - FRAME_WINDOW || frame < 0) return false;
+        out = checksums[frame % FRAME_WINDOW];
+        return true;
+    }
+
+    const RollbackStats& statistics() const { return stats; }
+
+private:
+    enum PacketType : uint8_t { PacketSync = 1, PacketInput = 2 };
+
+    static void put32(uint8_t* out, uint32_t value) {
+        for (int i = 0; i < 4; i++) out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    static uint32_t get32(const uint8_t* in) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(in[i]) << (8 * i);
+        return value;
+    }
+
+    static size_t writeHeader(uint8_t* out, PacketType type) {
+        std::memcpy(out, "RRNP", 4);
+        out[4] = type;
+        return 5;
+    }
+
+    void sendSync(double now) {
+        uint8_t packet[NET_MAX_PACKET];
+        size_t size = writeHeader(packet, PacketSync);
+        packet[size++] = static_cast<uint8_t>(localSlot);
+        put32(packet + size, localSeed);
+        size += 4;
+        packet[size++] = remoteSeen ? 1 : 0;
+        link.send(packet, size, now);
+    }
+
+    void sendInputs(double now) {
+        int first = std::max(remoteAck + 1, lastLocalFrame - MAX_INPUTS_PER_PACKET + 1);
+        int count = std::max(0, lastLocalFrame - first + 1);
+        uint8_t packet[NET_MAX_PACKET];
+        size_t size = writeHeader(packet, PacketInput);
+        put32(packet + size, static_cast<uint32_t>(lastRemoteFrame));
+        size += 4;
+        put32(packet + size, static_cast<uint32_t>(first));
+        size += 4;
+        packet[size++] = static_cast<uint8_t>(count);
+        for (int i = 0; i < count; i++) packet[size++] = localInputs[(first + i) % FRAME_WINDOW];
+        link.send(packet, size, now);
+    }
+
+    void pollNetwork(double now) {
+        uint8_t packet[NET_MAX_PACKET];
+        size_t size = 0;
+        while (link.receive(packet, size)) {
+            if (size < 5 || std::memcmp(packet, "RRNP", 4) != 0) continue;
+            if (packet[4] == PacketSync && size >= 11) {
+                int remoteSlot = packet[5];
+                if (remoteSlot == localSlot) {
+                    if (!slotClashReported) std::cerr << "Error: both peers claim player " << (localSlot + 1) << std::endl;
+                    slotClashReported = true;
+                    continue;
+                }
+                remoteSeed = get32(packet + 6);
+                remoteSeen = true;
+                if (packet[10]) remoteHeardUs = true;
+                // The peer is still handshaking: answer so it can start too.
+                else if (started) sendSync(now);
+            } else if (packet[4] == PacketInput && size >= 14) {
+                // Inputs only flow once the peer has finished the handshake.
+                remoteHeardUs = true;
+                if (started) readInputs(packet, size);
+            }
+        }
+    }
+
+    void readInputs(const uint8_t* packet, size_t size) {
+        int ack = static_cast<int32_t>(get32(packet + 5));
+        int first = static_cast<int32_t>(get32(packet + 9));
+        int count = packet[13];
+        if (size < 14 + static_cast<size_t>(count)) return;
+        remoteAck = std::max(remoteAck, std::min(ack, lastLocalFrame));
+
+        for (int i = 0; i < count; i++) {
+            int frame = first + i;
+            // Only extend the contiguous run; gaps are filled by a resend.
+            if (frame != lastRemoteFrame + 1 || frame >= currentFrame + FRAME_WINDOW / 2) continue;
+            uint8_t input = packet[14 + i];
+            remoteInputs[frame % FRAME_WINDOW] = input;
+            lastRemoteFrame = frame;
+            if (frame < currentFrame && usedRemoteInputs[frame % FRAME_WINDOW] != input &&
+                (firstMispredicted < 0 || frame < firstMispredicted)) {
+                firstMispredicted = frame;
+            }
+        }
+    }
+
+    uint8_t remoteInputFor(int frame) const {
+        if (frame <= lastRemoteFrame) return remoteInputs[frame % FRAME_WINDOW];
+        if (lastRemoteFrame < 0) return 0;
+        // Held buttons carry on; a jump is an edge and is not repeated.
+        return static_cast<uint8_t>(remoteInputs[lastRemoteFrame % FRAME_WINDOW] & ~InputJump);
+    }
+
+    void simulateFrame(int frame) {
+        sim.loadState(snapshots[frame % snapshots.size()]);
+
+        uint8_t remote = remoteInputFor(frame);
+        usedRemoteInputs[frame % FRAME_WINDOW] = remote;
+        PlayerInput inputs[MAX_PLAYERS];
+        inputs[localSlot] = unpackInput(localInputs[frame % FRAME_WINDOW]);
+        inputs[1 - localSlot] = unpackInput(remote);
+        sim.tick(NET_TICK, inputs);
+
+        int next = frame + 1;
+        sim.saveState(snapshots[next % snapshots.size()]);
+        checksums[next % FRAME_WINDOW] = sim.stateChecksum();
+        roundOverAt[next % FRAME_WINDOW] = sim.roundOver;
+    }
+
+    GameSim& sim;
+    UdpLink& link;
+    int localSlot;
+    int maxRollback;
+    int inputDelay;
+
+    bool seedProposed = false;
+    uint32_t localSeed = 0;
+    uint32_t remoteSeed = 0;
+    uint32_t seed = 0;
+    bool remoteSeen = false;
+    bool remoteHeardUs = false;
+    bool slotClashReported = false;
+    bool started = false;
+
+    int currentFrame = 0;           // next frame to simulate
+    int lastRemoteFrame = -1;       // every remote input up to here has arrived
+    int lastLocalFrame = -1;        // local inputs are recorded up to here
+    int remoteAck = -1;             // the peer has every local input up to here
+    int firstMispredicted = -1;
+
+    uint8_t localInputs[FRAME_WINDOW];
+    uint8_t remoteInputs[FRAME_WINDOW];
+    uint8_t usedRemoteInputs[FRAME_WINDOW];
+    uint64_t checksums[FRAME_WINDOW];
+    bool roundOverAt[FRAME_WINDOW];
+    std::vector<GameSnapshot> snapshots;   // state at the start of each frame in the rollback window
+
+    RollbackStats stats;
+};
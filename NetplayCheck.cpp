@@ -0,0 +1,143 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include "GameSim.h"
+#include "Netplay.h"
+#include "Bot.h"
+
+// Plays rollback versus matches between two sessions over loopback UDP,
+// with latency, jitter and packet loss applied to both directions. Each
+// side is driven by a bot that only sees its own (predicted) simulation,
+// like a player would. Every frame both sides have confirmed is compared by
+// checksum; any difference is a desync.
+//
+// Time is simulated: each loop iteration is one 60 Hz frame for both peers,
+// so the run is fast and repeatable, but rollback cost is measured for real.
+//
+// Usage: NetplayCheck [latencyMs] [lossPercent] [frames] [port]
+
+namespace {
+
+const float WINDOW_WIDTH = 1200.f;
+const float WINDOW_HEIGHT = 700.f;
+
+struct Peer {
+    Peer(const Tunables& tun, int slot)
+        : sim(tun, WINDOW_WIDTH, WINDOW_HEIGHT, false), slot(slot), bot(200) {}
+
+    GameSim sim;
+    UdpLink link;
+    int slot;
+    JumpBot bot;
+    BotObservation observation;
+    PlayerInput pending;    // kept until advance() accepts it
+};
+
+}
+
+int main(int argc, char** argv) {
+    float latencyMs = argc > 1 ? static_cast<float>(std::atof(argv[1])) : 50.f;
+    float lossPercent = argc > 2 ? static_cast<float>(std::atof(argv[2])) : 5.f;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 3600;
+    uint16_t port = static_cast<uint16_t>(argc > 4 ? std::atoi(argv[4]) : 47000);
+
+    Tunables tun = loadTunables("tunables.cfg");
+    BotWorld botWorld = makeBotWorld(tun, PIXELS_PER_METER, WINDOW_HEIGHT);
+
+    Peer peers[2] = { Peer(tun, 0), Peer(tun, 1) };
+    if (!peers[0].link.open(port, "127.0.0.1", static_cast<uint16_t>(port + 1)) ||
+        !peers[1].link.open(static_cast<uint16_t>(port + 1), "127.0.0.1", port)) {
+        return 1;
+    }
+    LinkConditions conditions;
+    conditions.latencyMs = latencyMs;
+    conditions.jitterMs = latencyMs * 0.2f;
+    conditions.lossRate = lossPercent / 100.f;
+    peers[0].link.setConditions(conditions, 1);
+    peers[1].link.setConditions(conditions, 2);
+
+    const double frameSeconds = NET_TICK;
+    double now = 0.0;
+    int framesPlayed = 0;
+    int matches = 0;
+    int framesCompared = 0;
+    int desyncs = 0;
+    double worstAdvanceMs = 0.0;
+    RollbackStats totals;
+
+    while (framesPlayed < frames) {
+        RollbackSession sessionA(peers[0].sim, peers[0].link, 0);
+        RollbackSession sessionB(peers[1].sim, peers[1].link, 1);
+        RollbackSession* sessions[2] = { &sessionA, &sessionB };
+
+        int handshakeFrames = 0;
+        bool readyA = false, readyB = false;
+        while (!(readyA && readyB)) {
+            // Keep both answering until both are through, as a started peer would.
+            readyA = sessionA.synchronise(1000u + matches, now);
+            readyB = sessionB.synchronise(2000u + matches, now);
+            now += frameSeconds;
+            if (++handshakeFrames > 600) {
+                std::cerr << "Error: handshake did not complete" << std::endl;
+                return 1;
+            }
+        }
+        sessionA.start();
+        sessionB.start();
+        if (sessionA.roundSeed() != sessionB.roundSeed()) {
+            std::cerr << "Error: peers agreed on different seeds" << std::endl;
+            return 1;
+        }
+
+        int nextToCompare = 0;
+        while (framesPlayed < frames && !(sessionA.roundFinished() && sessionB.roundFinished())) {
+            for (int p = 0; p < 2; p++) {
+                Peer& peer = peers[p];
+                if (peer.sim.players[peer.slot].body) {
+                    peer.sim.observe(peer.slot, peer.observation);
+                    PlayerInput thought = peer.bot.think(peer.observation, botWorld);
+                    peer.pending.jumpPressed = peer.pending.jumpPressed || thought.jumpPressed;
+                    peer.pending.fastFall = thought.fastFall;
+                }
+                if (sessions[p]->advance(peer.pending, now)) peer.pending = PlayerInput();
+            }
+            now += frameSeconds;
+            framesPlayed++;
+
+            int agreed = std::min(sessionA.confirmedFrame(), sessionB.confirmedFrame());
+            for (; nextToCompare <= agreed; nextToCompare++) {
+                uint64_t checksumA, checksumB;
+                if (!sessionA.confirmedChecksum(nextToCompare, checksumA) || !sessionB.confirmedChecksum(nextToCompare, checksumB)) continue;
+                framesCompared++;
+                if (checksumA != checksumB) {
+                    if (desyncs == 0) std::cerr << "Desync in match " << matches << " at frame " << nextToCompare << std::endl;
+                    desyncs++;
+                }
+            }
+        }
+
+        for (RollbackSession* session : sessions) {
+            const RollbackStats& stats = session->statistics();
+            totals.framesAdvanced += stats.framesAdvanced;
+            totals.rollbacks += stats.rollbacks;
+            totals.framesResimulated += stats.framesResimulated;
+            totals.maxRollbackDepth = std::max(totals.maxRollbackDepth, stats.maxRollbackDepth);
+            totals.stalls += stats.stalls;
+            worstAdvanceMs = std::max(worstAdvanceMs, stats.maxAdvanceMs);
+        }
+        std::cout << "match " << matches << ": seed " << sessionA.roundSeed() << ", " << sessionA.frame() << " frames, winner "
+                  << peers[0].sim.winner << "\n";
+        matches++;
+        peers[0].link.drain();
+        peers[1].link.drain();
+    }
+
+    std::cout << latencyMs << " ms latency, " << lossPercent << "% loss: " << framesPlayed << " frames in " << matches << " matches\n";
+    std::cout << "rollbacks " << totals.rollbacks << ", resimulated " << totals.framesResimulated << " frames"
+              << ", deepest " << totals.maxRollbackDepth << ", stalls " << totals.stalls << "\n";
+    std::cout << "slowest advance " << worstAdvanceMs << " ms, packets sent " << peers[0].link.packetsSent + peers[1].link.packetsSent
+              << ", dropped " << peers[0].link.packetsDropped + peers[1].link.packetsDropped << "\n";
+    std::cout << framesCompared << " confirmed frames compared, " << desyncs << " desyncs" << std::endl;
+    return (desyncs == 0 && worstAdvanceMs < 16.0) ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+#!/bin/sh
+# Builds a profile-guided, link-time-optimised release of the game and
+# compares its frame times with the plain build.
+#
+#  1. Training sessions: the ones given, or, if none are given, bot rounds
+#     recorded with Headless: two single-player, two versus and one
+#     single-player round with magenta rain most of the time.
+#  2. An instrumented game (-fprofile-generate) replays every session with
+#     --replay, drawing as fast as it can, to collect the profile.
+#  3. The release game is rebuilt from the profile with -flto -fprofile-use.
+#  4. The plain build and the release build each replay every session RUNS
+#     times. The best run of each is reported, with the change in p50 and p95
+#     frame time and CPU time per frame. A replay that ends differently from
+#     its recording is flagged, since the release build must still play the
+#     same game.
+#
+# Usage: ./PgoBuild.sh [output] [session...]
+#
+# The release binary goes to output (default ./RatRider-pgo). Needs g++, the
+# SFML and Box2D development packages and a display (xvfb-run is used when
+# DISPLAY is not set). CXX, CXXFLAGS (the plain build's flags), LIBS and RUNS
+# can be overridden. Everything runs in a scratch directory with copies of
+# the assets, so high score, leaderboard and ghost files here are left alone.
+
+SOURCE_DIR=$(cd "$(dirname "$0")" && pwd)
+OUTPUT=${1:-"$SOURCE_DIR/RatRider-pgo"}
+[ $# -gt 0 ] && shift
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-std=c++17 -O2"}
+LIBS=${LIBS:-"-lsfml-graphics -lsfml-window -lsfml-audio -lsfml-system -lbox2d -pthread"}
+RUNS=${RUNS:-3}
+if [ -n "$DISPLAY" ]; then RUN_GAME=""; else RUN_GAME="xvfb-run -a"; fi
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+for asset in "$SOURCE_DIR"/*.png "$SOURCE_DIR"/*.jpg "$SOURCE_DIR"/*.ogg "$SOURCE_DIR"/*.wav "$SOURCE_DIR"/*.ttf "$SOURCE_DIR"/tunables.cfg; do
+    [ -f "$asset" ] && cp "$asset" "$WORK_DIR"/
+done
+mkdir -p "$WORK_DIR/sessions"
+
+fail() {
+    echo "$1" >&2
+    [ -n "$2" ] && head -n 20 "$2" | sed 's/^/    /' >&2
+    exit 1
+}
+
+# The game, built from one object file whose path stays the same between
+# the instrumented and the profile-using build, so GCC finds its profile.
+build_game() {
+    flags=$1 binary=$2
+    $CXX $CXXFLAGS $flags -c "$SOURCE_DIR/Boxing10_1.cpp" -o "$WORK_DIR/Boxing10_1.o" 2> "$WORK_DIR/build.log" &&
+        $CXX $CXXFLAGS $flags "$WORK_DIR/Boxing10_1.o" -o "$binary" $LIBS 2>> "$WORK_DIR/build.log"
+}
+
+# 1. Training sessions.
+if [ $# -gt 0 ]; then
+    for session in "$@"; do cp "$session" "$WORK_DIR/sessions/" || exit 1; done
+else
+    $CXX $CXXFLAGS "$SOURCE_DIR/Headless.cpp" -o "$WORK_DIR/Headless" $LIBS 2> "$WORK_DIR/build.log" ||
+        fail "Headless failed to build" "$WORK_DIR/build.log"
+    cp "$WORK_DIR/tunables.cfg" "$WORK_DIR/magenta.cfg"
+    cat >> "$WORK_DIR/magenta.cfg" << 'EOF'
+magentaCollectibleProb = 0.2
+whiteCollectibleProb = 0.2
+magentaRainDuration = 30
+magentaRainSpawnInterval = 0.05
+EOF
+    (cd "$WORK_DIR" &&
+        ./Headless play single 1 7200 sessions/single-1.session &&
+        ./Headless play single 2 7200 sessions/single-2.session &&
+        ./Headless play versus 3 7200 sessions/versus-3.session &&
+        ./Headless play versus 4 7200 sessions/versus-4.session &&
+        ./Headless play single 5 7200 sessions/magenta-5.session magenta.cfg) > "$WORK_DIR/record.log" 2>&1 ||
+        fail "Recording training sessions failed" "$WORK_DIR/record.log"
+fi
+
+# 2. Instrumented build and training runs.
+build_game "-fprofile-generate -fprofile-update=atomic" "$WORK_DIR/game-instrumented" ||
+    fail "Instrumented build failed" "$WORK_DIR/build.log"
+for session in "$WORK_DIR"/sessions/*.session; do
+    (cd "$WORK_DIR" && $RUN_GAME ./game-instrumented --replay "$session" > "$WORK_DIR/train.log" 2>&1) ||
+        fail "Training run on $(basename "$session") failed" "$WORK_DIR/train.log"
+done
+
+# 3. Release build from the profile. Frame-time runs use the same binaries.
+build_game "-flto -fprofile-use -fprofile-correction -Wno-missing-profile" "$WORK_DIR/game-pgo" ||
+    fail "PGO+LTO build failed" "$WORK_DIR/build.log"
+build_game "" "$WORK_DIR/game-plain" || fail "Plain build failed" "$WORK_DIR/build.log"
+cp "$WORK_DIR/game-pgo" "$OUTPUT" || exit 1
+
+# 4. Frame times. Prints "p50 p95 cpu_ms_per_frame" for the best of RUNS
+# replays (lowest p95), "failed" if the game did not finish a replay, or
+# "diverged".
+best_of_runs() {
+    binary=$1 session=$2
+    best=""
+    run=0
+    while [ "$run" -lt "$RUNS" ]; do
+        (cd "$WORK_DIR" && $RUN_GAME "./$binary" --replay "$session" > "$WORK_DIR/run.log" 2>&1)
+        # Replay <matches|DIVERGED>: frames <n> wall_s <s> cpu_s <s> p50_ms <ms> p95_ms <ms> p99_ms <ms> max_ms <ms>
+        line=$(grep '^Replay ' "$WORK_DIR/run.log")
+        if [ -z "$line" ]; then
+            echo failed
+            return
+        fi
+        set -- $line
+        if [ "$2" != "matches:" ]; then
+            echo diverged
+            return
+        fi
+        result=$(awk -v frames="$4" -v cpu="$8" -v p50="${10}" -v p95="${12}" \
+            'BEGIN { printf "%.3f %.3f %.3f", p50, p95, (frames > 0) ? cpu * 1000 / frames : 0 }')
+        if [ -z "$best" ] || awk -v a="$(echo "$result" | cut -d' ' -f2)" -v b="$(echo "$best" | cut -d' ' -f2)" 'BEGIN { exit !(a < b) }'; then
+            best=$result
+        fi
+        run=$((run + 1))
+    done
+    echo "$best"
+}
+
+printf '%-22s %-8s %8s %8s %10s\n' session build p50_ms p95_ms cpu_ms/fr
+diverged=0     # replays that diverged or failed
+for session in "$WORK_DIR"/sessions/*.session; do
+    name=$(basename "$session" .session)
+    plain=$(best_of_runs game-plain "$session")
+    pgo=$(best_of_runs game-pgo "$session")
+    for build in plain pgo; do
+        eval "result=\$$build"
+        if [ "$result" = diverged ] || [ "$result" = failed ]; then
+            if [ "$result" = diverged ]; then note="DIVERGED from the recording"; else note="run failed"; fi
+            printf '%-22s %-8s %s\n' "$name" "$build" "$note"
+            diverged=$((diverged + 1))
+        else
+            set -- $result
+            printf '%-22s %-8s %8s %8s %10s\n' "$name" "$build" "$1" "$2" "$3"
+        fi
+    done
+    case "$plain $pgo" in *diverged*|*failed*) continue ;; esac
+    set -- $plain $pgo
+    awk -v p50="$1" -v p95="$2" -v cpu="$3" -v q50="$4" -v q95="$5" -v qcpu="$6" 'BEGIN {
+        change = "%-22s %-8s %+7.1f%% %+7.1f%% %+9.1f%%\n"
+        printf change, "", "change", (p50 > 0) ? (q50 - p50) * 100 / p50 : 0,
+            (p95 > 0) ? (q95 - p95) * 100 / p95 : 0, (cpu > 0) ? (qcpu - cpu) * 100 / cpu : 0
+    }'
+done
+
+echo "Release binary: $OUTPUT"
+[ "$diverged" -eq 0 ]
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "GameSim.h"
+#include "ThreadPool.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+
+// Values written to the dones buffer.
+enum EnvDone : uint8_t { NotDone = 0, DoneTerminated = 1, DoneTruncated = 2 };
+
+struct EnvConfig {
+    size_t numEnvs = 16;
+    size_t threads = 0;             // 0 = one per hardware thread
+    int platformSlots = 4;          // K: platforms ahead of the player in each observation
+    int collectibleSlots = 4;       // C: collectibles ahead of the player
+    float frameDt = 1.f / 60.f;
+    int actionRepeat = 1;           // ticks per step with the same action (jump only on the first)
+    int maxSteps = 60 * 60 * 5;     // episode is truncated after this many steps
+    float survivalReward = 0.01f;   // per step alive
+    float deathPenalty = 1.f;
+    float windowWidth = 1200.f;
+    float windowHeight = 700.f;
+    Tunables tun;
+};
+
+
+// Batch of independent single-player games stepped together.
+//
+// Observation layout per environment, all floats, positions relative to the
+// player and scaled by the window size:
+//   [0] player y / windowHeight     [1] player vy / jumpSpeed
+//   [2] grounded (0/1)               [3] jumps remaining / maxJumps
+//   [4] block speed / maxBlockSpeed  [5] platform effect (-1 shorten, 0, 1 lengthen)
+//   [6] magenta rain active (0/1)
+//   then K platforms:    present, left dx, right dx, top dy
+//   then C collectibles: present, dx, dy, value / orangeScore
+// Slots are filled nearest-first with objects not yet behind the player;
+// unused slots are zero.
+//
+// step() takes one packInput() byte per environment and writes straight into
+// the caller's buffers (numEnvs * observationSize() floats, numEnvs rewards
+// and dones). An environment that finishes is reset
+// at once, so the observation returned with done != 0 is the first one of
+// its next episode.
+class RatRiderEnv {
+public:
+    static constexpr int PLAYER_FEATURES = 7;
+    static constexpr int SLOT_FEATURES = 4;
+
+    explicit RatRiderEnv(const EnvConfig& envConfig)
+        : config(envConfig),
+          pool(envConfig.threads ? envConfig.threads : std::max(1u, std::thread::hardware_concurrency())) {
+        for (size_t i = 0; i < config.numEnvs; i++) {
+            slots.emplace_back(new EnvSlot(config));
+        }
+    }
+
+    size_t numEnvs() const { return config.numEnvs; }
+    size_t threadCount() const { return pool.size(); }
+
+    size_t observationSize() const {
+        return PLAYER_FEATURES + SLOT_FEATURES * (config.platformSlots + config.collectibleSlots);
+    }
+
+    // Starts every environment from a seed derived from `seed`, so a batch is reproducible.
+    void reset(uint32_t seed, float* observations) {
+        baseSeed = seed;
+        pool.parallelFor(slots.size(), [&](size_t i) {
+            EnvSlot& slot = *slots[i];
+            slot.episode = 0;
+            startEpisode(slot, i);
+            writeObservation(slot.sim, observations + i * observationSize());
+        });
+    }
+
+    void step(const uint8_t* actions, float* observations, float* rewards, uint8_t* dones) {
+        pool.parallelFor(slots.size(), [&](size_t i) {
+            EnvSlot& slot = *slots[i];
+            GameSim& sim = slot.sim;
+            int scoreBefore = sim.score;
+
+            PlayerInput inputs[MAX_PLAYERS];
+            inputs[0] = unpackInput(actions[i]);
+            for (int repeat = 0; repeat < config.actionRepeat && !sim.roundOver; repeat++) {
+                sim.tick(config.frameDt, inputs);
+                inputs[0].jumpPressed = false;
+            }
+            slot.steps++;
+
+            float reward = static_cast<float>(sim.score - scoreBefore);
+            uint8_t done = NotDone;
+            if (sim.roundOver) {
+                reward -= config.deathPenalty;
+                done = DoneTerminated;
+            } else {
+                reward += config.survivalReward;
+                if (slot.steps >= config.maxSteps) done = DoneTruncated;
+            }
+            rewards[i] = reward;
+            dones[i] = done;
+
+            if (done != NotDone) {
+                slot.episode++;
+                startEpisode(slot, i);
+            }
+            writeObservation(sim, observations + i * observationSize());
+        });
+    }
+
+    // Direct access for debugging and rendering a single environment.
+    const GameSim& simulation(size_t index) const { return slots[index]->sim; }
+
+private:
+    struct EnvSlot {
+        explicit EnvSlot(const EnvConfig& config)
+            : sim(config.tun, config.windowWidth, config.windowHeight, false) {}
+        GameSim sim;
+        int steps = 0;
+        uint32_t episode = 0;
+    };
+
+    void startEpisode(EnvSlot& slot, size_t index) {
+        // Spread seeds so no two environments or episodes share a course.
+        uint32_t seed = baseSeed ^ (static_cast<uint32_t>(index) * 0x9E3779B9u) ^ (slot.episode * 0x85EBCA6Bu);
+        slot.sim.startRound(SinglePlayerMode, seed);
+        slot.steps = 0;
+    }
+
+    void writeObservation(const GameSim& sim, float* out) const {
+        const Tunables& tun = sim.tun;
+        const SimPlayer& player = sim.players[0];
+        const float invWidth = 1.f / sim.windowWidth;
+        const float invHeight = 1.f / sim.windowHeight;
+        const float playerX = player.x;
+        const float playerY = player.y;
+        const float behind = playerX - tun.playerWidth / 2.f;
+
+        std::fill(out, out + observationSize(), 0.f);
+        out[0] = playerY * invHeight;
+        out[1] = player.body ? player.body->GetLinearVelocity().y * PIXELS_PER_METER / tun.playerJumpForce : 0.f;
+        out[2] = player.grounded ? 1.f : 0.f;
+        out[3] = static_cast<float>(player.jumpsRemaining) / static_cast<float>(std::max(1, tun.maxJumps));
+        out[4] = sim.blockSpeed / tun.maxBlockSpeed;
+        out[5] = sim.currentPlatformEffect == PlatformEffect::Lengthen ? 1.f :
+                 sim.currentPlatformEffect == PlatformEffect::Shorten ? -1.f : 0.f;
+        out[6] = sim.isRainingMagenta ? 1.f : 0.f;
+
+        // Platforms are kept in spawn order, which is also left-to-right order.
+        float* slot = out + PLAYER_FEATURES;
+        int filled = 0;
+        for (const SimPlatform& platform : sim.platforms) {
+            if (filled == config.platformSlots) break;
+            float halfLength = platform.length / 2.f;
+            if (platform.x + halfLength < behind) continue;
+            slot[0] = 1.f;
+            slot[1] = (platform.x - halfLength - playerX) * invWidth;
+            slot[2] = (platform.x + halfLength - playerX) * invWidth;
+            slot[3] = (platform.y - tun.fixedHeight / 2.f - playerY) * invHeight;
+            slot += SLOT_FEATURES;
+            filled++;
+        }
+
+        // Rain makes collectible order arbitrary, so pick the nearest ones ahead.
+        slot = out + PLAYER_FEATURES + SLOT_FEATURES * config.platformSlots;
+        const float valueScale = 1.f / static_cast<float>(std::max(1, tun.orangeScore));
+        float lastDx = -1e30f;
+        for (int n = 0; n < config.collectibleSlots; n++) {
+            const SimCollectible* nearest = nullptr;
+            float nearestDx = 1e30f;
+            for (const SimCollectible& collectible : sim.collectibles) {
+                float dx = collectible.x - playerX;
+                if (collectible.x + tun.collectibleRadius < behind || dx <= lastDx || dx >= nearestDx) continue;
+                nearest = &collectible;
+                nearestDx = dx;
+            }
+            if (!nearest) break;
+            slot[0] = 1.f;
+            slot[1] = nearestDx * invWidth;
+            slot[2] = (nearest->y - playerY) * invHeight;
+            slot[3] = sim.collectibleValue(nearest->type) * valueScale;
+            slot += SLOT_FEATURES;
+            lastDx = nearestDx;
+        }
+    }
+
+    EnvConfig config;
+    ThreadPool pool;
+    std::vector<std::unique_ptr<EnvSlot>> slots;
+    uint32_t baseSeed = 0;
+};
@@ -0,0 +1,72 @@
+#!/bin/sh
+# Builds every revision of the game with RevisionShim.h force-included, runs
+# each on the same scripted input and seed for the same number of frames,
+# and prints frame-time and CPU figures side by side. A revision is flagged
+# when its p95 frame time or CPU time per frame is more than the threshold
+# worse than the revision before it in the list, so each new BoxingN is
+# judged against the last one.
+#
+# Usage: ./RevisionBench.sh [frames] [thresholdPercent] [revision...]
+#
+# Needs a display (use xvfb-run on a headless machine) and the SFML and
+# Box2D development packages. CXX, CXXFLAGS and LIBS can be overridden.
+# Revisions that fail to build are reported and skipped. Runs happen in a
+# scratch directory holding copies of the assets, so high score, leaderboard
+# and ghost files here are left alone.
+
+FRAMES=${1:-3600}
+THRESHOLD=${2:-10}
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] && shift
+REVISIONS=${*:-"Phase1 Phase1_1 Phase2 Boxing2 Boxing3 Boxing4 Boxing6_1 Boxing8_3 Boxing9_2 Boxing9_2_Fixed Boxing10_1"}
+
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-std=c++17 -O2"}
+LIBS=${LIBS:-"-lsfml-graphics -lsfml-window -lsfml-audio -lsfml-system -lbox2d -pthread"}
+
+SOURCE_DIR=$(cd "$(dirname "$0")" && pwd)
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+for asset in "$SOURCE_DIR"/*.png "$SOURCE_DIR"/*.jpg "$SOURCE_DIR"/*.ogg "$SOURCE_DIR"/*.wav "$SOURCE_DIR"/*.ttf "$SOURCE_DIR"/tunables.cfg; do
+    [ -f "$asset" ] && cp "$asset" "$WORK_DIR"/
+done
+
+printf '%-16s %8s %8s %8s %8s %8s %10s  %s\n' revision frames p50_ms p95_ms p99_ms max_ms cpu_ms/fr note
+previous_p95=""
+previous_cpu=""
+regressions=0
+for revision in $REVISIONS; do
+    if ! $CXX $CXXFLAGS -I"$SOURCE_DIR" -include "$SOURCE_DIR/RevisionShim.h" "$SOURCE_DIR/$revision.cpp" \
+            -o "$WORK_DIR/$revision" $LIBS 2> "$WORK_DIR/$revision.build.log"; then
+        printf '%-16s %s\n' "$revision" "build failed (see below)"
+        head -n 5 "$WORK_DIR/$revision.build.log" | sed 's/^/    /'
+        continue
+    fi
+    rm -f "$WORK_DIR/result"
+    (cd "$WORK_DIR" && RAT_RIDER_BENCH_FRAMES=$FRAMES RAT_RIDER_BENCH_SEED=1 RAT_RIDER_BENCH_OUT="$WORK_DIR/result" \
+        "./$revision" > "$WORK_DIR/$revision.run.log" 2>&1)
+    if [ ! -s "$WORK_DIR/result" ]; then
+        printf '%-16s %s\n' "$revision" "run failed"
+        continue
+    fi
+    # frames <n> wall_s <s> cpu_s <s> p50_ms <ms> p95_ms <ms> p99_ms <ms> max_ms <ms>
+    set -- $(cat "$WORK_DIR/result")
+    frames=$2 cpu=$6 p50=$8 p95=${10} p99=${12} max=${14}
+    cpu_per_frame=$(awk -v cpu="$cpu" -v frames="$frames" 'BEGIN { printf "%.3f", (frames > 0) ? cpu * 1000 / frames : 0 }')
+    note=""
+    if [ -n "$previous_p95" ]; then
+        note=$(awk -v p95="$p95" -v prevP95="$previous_p95" -v cpu="$cpu_per_frame" -v prevCpu="$previous_cpu" -v limit="$THRESHOLD" 'BEGIN {
+            out = ""
+            if (prevP95 > 0 && (p95 - prevP95) * 100 / prevP95 > limit) out = out sprintf("p95 +%.0f%% ", (p95 - prevP95) * 100 / prevP95)
+            if (prevCpu > 0 && (cpu - prevCpu) * 100 / prevCpu > limit) out = out sprintf("cpu +%.0f%% ", (cpu - prevCpu) * 100 / prevCpu)
+            if (out != "") printf "REGRESSION %s", out
+        }')
+    fi
+    case "$note" in REGRESSION*) regressions=$((regressions + 1)) ;; esac
+    printf '%-16s %8s %8s %8s %8s %8s %10s  %s\n' "$revision" "$frames" "$p50" "$p95" "$p99" "$max" "$cpu_per_frame" "$note"
+    previous_p95=$p95
+    previous_cpu=$cpu_per_frame
+done
+
+echo "$regressions regression(s) beyond ${THRESHOLD}%"
+[ "$regressions" -eq 0 ]
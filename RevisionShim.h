@@ -0,0 +1,189 @@
+#pragma once
+
+// Force-included (g++ -include RevisionShim.h) into any revision of the game
+// by RevisionBench.sh, so every revision plays the same scripted session and
+// reports comparable numbers. It replaces, by macro, after the real headers
+// are in:
+//  - sf::RenderWindow: no frame limit or vsync, scripted input instead of the
+//    keyboard, closes itself after RAT_RIDER_BENCH_FRAMES frames, and times
+//    every frame at display();
+//  - sf::Clock: advances exactly 1/60 s per displayed frame, so each
+//    revision simulates the same game time per frame however fast it runs;
+//  - std::random_device: returns RAT_RIDER_BENCH_SEED, then counts up.
+// The summary goes to RAT_RIDER_BENCH_OUT (default stdout) as one line:
+//   frames <n> wall_s <s> cpu_s <s> p50_ms <ms> p95_ms <ms> p99_ms <ms> max_ms <ms>
+//
+// The script, every revision sees alike: every 60 frames a "1" key press
+// and a left click on the middle of the screen (the single-player entry in
+// the menus that have one) and Space (restart from game over); every 40
+// frames a one-frame tap of W (jump).
+
+#include <SFML/Graphics.hpp>
+#include <SFML/Audio.hpp>
+#include <random>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+
+// Lets code that paces or idles by itself run flat out under the bench, the
+// way the setFramerateLimit() override below does for the window.
+#define RAT_RIDER_REVISION_SHIM 1
+
+#include "FramePacing.h"
+
+namespace revision_shim {
+
+inline long envNumber(const char* name, long fallback) {
+    const char* value = std::getenv(name);
+    return value ? std::atol(value) : fallback;
+}
+
+struct Session {
+    long frameLimit = envNumber("RAT_RIDER_BENCH_FRAMES", 3600);
+    long frames = 0;            // displayed so far; drives the fake clock
+    FrameTimeHistogram frameTimes;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastDisplay = started;
+    std::clock_t cpuStart = std::clock();
+
+    ~Session() {
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        double cpu = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        const char* path = std::getenv("RAT_RIDER_BENCH_OUT");
+        FILE* out = path ? std::fopen(path, "w") : stdout;
+        if (!out) return;
+        std::fprintf(out, "frames %ld wall_s %.3f cpu_s %.3f p50_ms %.3f p95_ms %.3f p99_ms %.3f max_ms %.3f\n",
+                     frames, wall, cpu, frameTimes.percentile(50) / 1000.0, frameTimes.percentile(95) / 1000.0,
+                     frameTimes.percentile(99) / 1000.0, frameTimes.max() / 1000.0);
+        if (out != stdout) std::fclose(out);
+    }
+};
+
+inline Session& session() {
+    static Session s;
+    return s;
+}
+
+}
+
+namespace sf {
+
+class ShimRenderWindow : public RenderWindow {
+public:
+    ShimRenderWindow(VideoMode mode, const String& title, Uint32 style = Style::Default,
+                     const ContextSettings& settings = ContextSettings())
+        : RenderWindow(mode, title, style, settings) {
+        revision_shim::session();
+        RenderWindow::setFramerateLimit(0);
+        RenderWindow::setVerticalSyncEnabled(false);
+    }
+
+    // Revisions ask for 60 fps or vsync; the bench wants to see their real cost.
+    void setFramerateLimit(unsigned int) {}
+    void setVerticalSyncEnabled(bool) {}
+
+    bool pollEvent(Event& event) {
+        revision_shim::Session& s = revision_shim::session();
+        if (scriptedFrame != s.frames) {
+            scriptedFrame = s.frames;
+            queueScript(s.frames, s.frames >= s.frameLimit);
+        }
+        if (queued > 0) {
+            event = script[--queued];
+            return true;
+        }
+        // Real events are dropped so stray input cannot change the session.
+        Event ignored;
+        while (RenderWindow::pollEvent(ignored)) {}
+        return false;
+    }
+
+    void display() {
+        RenderWindow::display();
+        revision_shim::Session& s = revision_shim::session();
+        auto now = std::chrono::steady_clock::now();
+        if (s.frames > 0) s.frameTimes.record(std::chrono::duration_cast<std::chrono::microseconds>(now - s.lastDisplay).count());
+        s.lastDisplay = now;
+        s.frames++;
+    }
+
+private:
+    // Filled in reverse, popped from the back.
+    void queueScript(long frame, bool finished) {
+        queued = 0;
+        if (finished) {
+            script[queued].type = Event::Closed;
+            queued++;
+            return;
+        }
+        if (frame % 40 == 1) push(Event::KeyReleased, Keyboard::W);
+        if (frame % 40 == 0) push(Event::KeyPressed, Keyboard::W);
+        if (frame % 60 == 30) {
+            push(Event::KeyPressed, Keyboard::Space);
+            Event click;
+            click.type = Event::MouseButtonPressed;
+            click.mouseButton.button = Mouse::Left;
+            click.mouseButton.x = static_cast<int>(getSize().x / 2);
+            click.mouseButton.y = static_cast<int>(getSize().y / 2 - 30);
+            script[queued++] = click;
+            push(Event::KeyPressed, Keyboard::Num1);
+        }
+    }
+
+    void push(Event::EventType type, Keyboard::Key key) {
+        Event event;
+        event.type = type;
+        event.key.code = key;
+        event.key.alt = event.key.control = event.key.shift = event.key.system = false;
+        script[queued++] = event;
+    }
+
+    Event script[8];
+    int queued = 0;
+    long scriptedFrame = -1;
+};
+
+class ShimClock {
+public:
+    ShimClock() : startFrame(revision_shim::session().frames) {}
+
+    Time getElapsedTime() const {
+        return microseconds(static_cast<Int64>((revision_shim::session().frames - startFrame) * 1000000 / 60));
+    }
+
+    Time restart() {
+        Time elapsed = getElapsedTime();
+        startFrame = revision_shim::session().frames;
+        return elapsed;
+    }
+
+private:
+    long startFrame;
+};
+
+}
+
+namespace std {
+
+// Not a real random_device: a fixed, counting seed so every run matches.
+class ShimRandomDevice {
+public:
+    typedef unsigned int result_type;
+    ShimRandomDevice() : next(static_cast<result_type>(revision_shim::envNumber("RAT_RIDER_BENCH_SEED", 1))) {}
+    explicit ShimRandomDevice(const std::string&) : ShimRandomDevice() {}
+    result_type operator()() { return next++; }
+    double entropy() const noexcept { return 0.0; }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+private:
+    result_type next;
+};
+
+}
+
+#define RenderWindow ShimRenderWindow
+#define Clock ShimClock
+#define random_device ShimRandomDevice
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include "GameSim.h"
+#include "AtomicFile.h"
+
+
+static constexpr uint32_t SESSION_VERSION = 2;
+
+
+// Everything needed to play one round again through GameSim: the tunables
+// and window size it was created with, the mode, players and seed it started with,
+// and every tick's dt and inputs in order. Replaying the ticks on a fresh
+// GameSim reproduces the round exactly, which finalChecksum confirms.
+struct SessionRecording {
+    struct Tick {
+        float dt = 0.f;
+        uint8_t inputs[MAX_PLAYERS] = {};   // packInput() per player slot
+    };
+
+    Tunables tunables;
+    float windowWidth = 0.f;
+    float windowHeight = 0.f;
+    GameMode mode = SinglePlayerMode;
+    int playerCount = 1;
+    uint32_t seed = 0;
+    std::vector<Tick> ticks;
+    int32_t finalScore = 0;
+    uint64_t finalChecksum = 0;
+};
+
+
+// Records the ticks of a locally played round. begin() right after
+// GameSim::startRound(), record() with exactly what each sim.tick() got,
+// finish() once the round has ended.
+class SessionRecorder {
+public:
+    void begin(const GameSim& sim) {
+        recording = SessionRecording();
+        recording.tunables = sim.tun;
+        recording.windowWidth = sim.windowWidth;
+        recording.windowHeight = sim.windowHeight;
+        recording.mode = sim.mode;
+        recording.playerCount = sim.playerCount;
+        recording.seed = sim.roundSeed;
+        recording.ticks.reserve(60 * 60 * 5);
+        active = true;
+    }
+
+    void record(float dt, const PlayerInput* inputs) {
+        if (!active) return;
+        SessionRecording::Tick tick;
+        tick.dt = dt;
+        for (int p = 0; p < MAX_PLAYERS; p++) tick.inputs[p] = packInput(inputs[p]);
+        recording.ticks.push_back(tick);
+    }
+
+    // Something outside the recording changed the round (a tunables reload),
+    // so it could not be replayed faithfully.
+    void abandon() { active = false; }
+
+    bool isActive() const { return active; }
+
+    const SessionRecording& finish(const GameSim& sim) {
+        recording.finalScore = sim.score;
+        recording.finalChecksum = sim.stateChecksum();
+        active = false;
+        return recording;
+    }
+
+private:
+    SessionRecording recording;
+    bool active = false;
+};
+
+
+namespace session_file {
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t tunablesLayout;    // tunablesLayoutHash() of the writer
+    uint32_t playerSlots;       // players in the round, and input bytes per tick
+    float windowWidth;
+    float windowHeight;
+    int32_t mode;
+    uint32_t seed;
+    uint32_t tickCount;
+    int32_t finalScore;
+    uint64_t finalChecksum;
+};
+
+}
+
+inline bool saveSession(const std::string& path, const SessionRecording& session) {
+    session_file::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "RRSN", 4);
+    header.version = SESSION_VERSION;
+    header.tunablesLayout = tunablesLayoutHash();
+    header.playerSlots = static_cast<uint32_t>(session.playerCount);
+    header.windowWidth = session.windowWidth;
+    header.windowHeight = session.windowHeight;
+    header.mode = static_cast<int32_t>(session.mode);
+    header.seed = session.seed;
+    header.tickCount = static_cast<uint32_t>(session.ticks.size());
+    header.finalScore = session.finalScore;
+    header.finalChecksum = session.finalChecksum;
+
+    const size_t tickSize = sizeof(float) + header.playerSlots;
+    std::vector<char> image(sizeof(header) + sizeof(Tunables) + session.ticks.size() * tickSize);
+    char* out = image.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    std::memcpy(out, &session.tunables, sizeof(Tunables));
+    out += sizeof(Tunables);
+    for (const SessionRecording::Tick& tick : session.ticks) {
+        std::memcpy(out, &tick.dt, sizeof(float));
+        std::memcpy(out + sizeof(float), tick.inputs, header.playerSlots);
+        out += tickSize;
+    }
+    if (!writeFileAtomically(path, image.data(), image.size())) {
+        std::cerr << "Error writing session '" << path << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Only the slots of players in the round are stored; the rest load idle.
+inline bool loadSession(const std::string& path, SessionRecording& session) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error opening session '" << path << "'" << std::endl;
+        return false;
+    }
+    std::vector<char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    session_file::Header header;
+    if (image.size() < sizeof(header)) {
+        std::cerr << "Error reading session '" << path << "': too short" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (std::memcmp(header.magic, "RRSN", 4) != 0 || header.version != SESSION_VERSION) {
+        std::cerr << "Error reading session '" << path << "': not a session file" << std::endl;
+        return false;
+    }
+    if (header.tunablesLayout != tunablesLayoutHash() || header.playerSlots == 0 ||
+        header.playerSlots > static_cast<uint32_t>(MAX_PLAYERS)) {
+        std::cerr << "Error reading session '" << path << "': recorded by an incompatible build" << std::endl;
+        return false;
+    }
+    const size_t tickSize = sizeof(float) + header.playerSlots;
+    if (image.size() != sizeof(header) + sizeof(Tunables) + static_cast<size_t>(header.tickCount) * tickSize) {
+        std::cerr << "Error reading session '" << path << "': truncated" << std::endl;
+        return false;
+    }
+
+    const char* in = image.data() + sizeof(header);
+    std::memcpy(&session.tunables, in, sizeof(Tunables));
+    in += sizeof(Tunables);
+    session.windowWidth = header.windowWidth;
+    session.windowHeight = header.windowHeight;
+    session.mode = static_cast<GameMode>(header.mode);
+    session.playerCount = static_cast<int>(header.playerSlots);
+    session.seed = header.seed;
+    session.finalScore = header.finalScore;
+    session.finalChecksum = header.finalChecksum;
+    session.ticks.assign(header.tickCount, SessionRecording::Tick());
+    for (SessionRecording::Tick& tick : session.ticks) {
+        std::memcpy(&tick.dt, in, sizeof(float));
+        std::memcpy(tick.inputs, in + sizeof(float), header.playerSlots);
+        in += tickSize;
+    }
+    return true;
+}
+
+// Plays a recording on sim, which must have been built with the session's
+// tunables and window size. Returns false if the result differs from the
+// recorded one.
+inline bool replaySession(GameSim& sim, const SessionRecording& session) {
+    PlayerInput inputs[MAX_PLAYERS];
+    sim.startRound(session.mode, session.seed, session.playerCount);
+    for (const SessionRecording::Tick& tick : session.ticks) {
+        for (int p = 0; p < MAX_PLAYERS; p++) inputs[p] = unpackInput(tick.inputs[p]);
+        sim.tick(tick.dt, inputs);
+    }
+    return sim.score == session.finalScore && sim.stateChecksum() == session.finalChecksum;
+}
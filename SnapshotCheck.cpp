@@ -0,0 +1,150 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "GameSim.h"
+#include "Bot.h"
+
+// Checks GameSim::saveState()/loadState() and times them.
+//
+// A single-player round (collectibles on) is played with scripted input by
+// a simulation that is never restored. Every `interval` ticks its state is
+// saved and loaded into a second simulation, and then:
+//  - exactness: saving again after the load must give the same bytes and
+//    the same checksum;
+//  - determinism: two replays of the next `replay` ticks, each starting from
+//    the same snapshot, must match tick for tick;
+//  - no drift: the replay must also match the uninterrupted run over the
+//    same ticks, since live ticks go through the same world rebuild as a
+//    restore.
+// Finished rounds are restarted with a new seed.
+//
+// Usage: SnapshotCheck [ticks] [interval] [replay]
+
+namespace {
+
+const float FRAME_DT = 1.f / 60.f;
+const float WINDOW_WIDTH = 1200.f;
+const float WINDOW_HEIGHT = 700.f;
+
+uint8_t scriptedInput(uint32_t seed, int tick) {
+    uint32_t h = (seed * 0x9E3779B9u) ^ (static_cast<uint32_t>(tick) * 0x85EBCA6Bu);
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    uint8_t bits = 0;
+    if (h % 30 == 0) bits |= InputJump;
+    if ((h >> 8) % 11 == 0) bits |= InputFastFall;
+    return bits;
+}
+
+double microsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void replayFrom(GameSim& sim, const GameSnapshot& snapshot, uint32_t seed, int firstTick, int ticks, std::vector<uint64_t>& checksums) {
+    sim.loadState(snapshot);
+    checksums.clear();
+    PlayerInput inputs[MAX_PLAYERS];
+    for (int t = 0; t < ticks; t++) {
+        inputs[0] = unpackInput(scriptedInput(seed, firstTick + t));
+        sim.tick(FRAME_DT, inputs);
+        checksums.push_back(sim.stateChecksum());
+    }
+}
+
+// A restored replay waiting for the uninterrupted run to reach its ticks.
+struct PendingDrift {
+    int firstTick;      // tick of the uninterrupted run its first checksum belongs to
+    std::vector<uint64_t> checksums;
+};
+
+}
+
+int main(int argc, char** argv) {
+    int ticks = argc > 1 ? std::atoi(argv[1]) : 36000;
+    int interval = argc > 2 ? std::atoi(argv[2]) : 30;
+    int replay = argc > 3 ? std::atoi(argv[3]) : 60;
+
+    Tunables tun = loadTunables("tunables.cfg");
+    GameSim live(tun, WINDOW_WIDTH, WINDOW_HEIGHT, false);
+    GameSim sim(tun, WINDOW_WIDTH, WINDOW_HEIGHT, false);
+    uint32_t seed = 1;
+    live.startRound(SinglePlayerMode, seed);
+
+    GameSnapshot snapshot, resaved;
+    std::vector<uint64_t> first, second;
+    std::vector<PendingDrift> pending;
+    PlayerInput inputs[MAX_PLAYERS];
+    int roundTick = 0;
+    int checks = 0, inexact = 0, nondeterministic = 0;
+    int driftCompared = 0, drifted = 0, earliestDrift = -1;
+    double saveMicros = 0.0, loadMicros = 0.0, maxSaveMicros = 0.0, maxLoadMicros = 0.0;
+    size_t maxBytes = 0;
+
+    for (int tick = 0; tick < ticks; tick++) {
+        inputs[0] = unpackInput(scriptedInput(seed, roundTick));
+        live.tick(FRAME_DT, inputs);
+        roundTick++;
+        if (live.roundOver) {
+            // Replays that ran past the end of the round cannot be compared.
+            pending.clear();
+            seed++;
+            live.startRound(SinglePlayerMode, seed);
+            roundTick = 0;
+            continue;
+        }
+
+        uint64_t liveChecksum = live.stateChecksum();
+        for (size_t i = 0; i < pending.size();) {
+            int offset = tick - pending[i].firstTick;
+            if (pending[i].checksums[offset] != liveChecksum) {
+                drifted++;
+                driftCompared++;
+                if (earliestDrift < 0 || offset + 1 < earliestDrift) earliestDrift = offset + 1;
+                pending.erase(pending.begin() + static_cast<long>(i));
+            } else if (offset + 1 == static_cast<int>(pending[i].checksums.size())) {
+                driftCompared++;
+                pending.erase(pending.begin() + static_cast<long>(i));
+            } else {
+                i++;
+            }
+        }
+        if (tick % interval != 0) continue;
+
+        uint64_t before = liveChecksum;
+        auto start = std::chrono::steady_clock::now();
+        live.saveState(snapshot);
+        double saveTime = microsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        if (!sim.loadState(snapshot)) {
+            std::cerr << "Error: a fresh snapshot was rejected" << std::endl;
+            return 1;
+        }
+        double loadTime = microsSince(start);
+        sim.saveState(resaved);
+        if (resaved.bytes != snapshot.bytes || sim.stateChecksum() != before) inexact++;
+
+        saveMicros += saveTime;
+        loadMicros += loadTime;
+        maxSaveMicros = std::max(maxSaveMicros, saveTime);
+        maxLoadMicros = std::max(maxLoadMicros, loadTime);
+        maxBytes = std::max(maxBytes, snapshot.bytes.size());
+        checks++;
+
+        replayFrom(sim, snapshot, seed, roundTick, replay, first);
+        replayFrom(sim, snapshot, seed, roundTick, replay, second);
+        if (first != second) nondeterministic++;
+        if (!first.empty()) pending.push_back(PendingDrift{tick + 1, first});
+    }
+
+    std::cout << checks << " snapshots over " << ticks << " ticks (" << seed << " rounds), up to " << maxBytes << " bytes\n";
+    std::cout << "save " << saveMicros / std::max(checks, 1) << " us avg, " << maxSaveMicros << " us max\n";
+    std::cout << "load " << loadMicros / std::max(checks, 1) << " us avg, " << maxLoadMicros << " us max\n";
+    std::cout << inexact << " inexact restores, " << nondeterministic << " replays that diverged\n";
+    std::cout << drifted << " of " << driftCompared << " restored replays drifted from the uninterrupted run";
+    if (drifted > 0) std::cout << ", earliest " << earliestDrift << " ticks after the restore";
+    std::cout << std::endl;
+    return (inexact == 0 && nondeterministic == 0 && drifted == 0) ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <SFML/Audio.hpp>
+#include <vector>
+#include <cstdint>
+
+
+enum SoundCategory { SoundPickup, SoundEffect, SoundUi, SoundCategoryCount };
+
+
+// Fixed set of preallocated voices shared by every sound cue in the game.
+// - Each category has a voice limit; a cue over its limit steals the oldest
+//   voice of that category whose priority is not higher than its own.
+// - When no voice is free, the lowest-priority, oldest voice is stolen, or
+//   the cue is dropped if every voice outranks it.
+// - The same buffer is triggered at most once per frame and category, so a
+//   burst of identical events (e.g. magenta rain pickups) costs one play()
+//   call. A later cue of higher priority takes over the earlier one's voice
+//   with its own priority, volume and pitch.
+class SoundPool {
+public:
+    static constexpr size_t MAX_CUES_PER_FRAME = 16;
+
+    explicit SoundPool(size_t voiceCount = 16) : voices(voiceCount) {
+        for (int i = 0; i < SoundCategoryCount; i++) categoryLimits[i] = static_cast<int>(voiceCount);
+    }
+
+    void setCategoryLimit(SoundCategory category, int maxVoices) {
+        categoryLimits[category] = maxVoices;
+    }
+
+    // Call once at the start of every frame.
+    void beginFrame() {
+        cuesThisFrame = 0;
+    }
+
+    // Returns false if the cue was deduplicated or dropped.
+    bool play(const sf::SoundBuffer& buffer, SoundCategory category, int priority = 0, float volume = 100.f, float pitch = 1.f) {
+        for (size_t i = 0; i < cuesThisFrame; i++) {
+            FrameCue& cue = frameCues[i];
+            if (cue.buffer != &buffer || cue.category != category || cue.voice->startedAt != cue.startedAt) continue;
+            if (priority <= cue.priority) return false;
+            cue.priority = priority;
+            start(*cue.voice, buffer, category, priority, volume, pitch);
+            cue.startedAt = cue.voice->startedAt;
+            return true;
+        }
+        if (cuesThisFrame == MAX_CUES_PER_FRAME) return false;
+
+        Voice* target = nullptr;
+        Voice* oldestInCategory = nullptr;
+        Voice* freeVoice = nullptr;
+        Voice* cheapestVoice = nullptr;
+        int activeInCategory = 0;
+        for (Voice& voice : voices) {
+            bool playing = voice.sound.getStatus() == sf::SoundSource::Playing;
+            if (!playing) {
+                if (!freeVoice) freeVoice = &voice;
+                continue;
+            }
+            if (voice.category == category) {
+                activeInCategory++;
+                if (voice.priority <= priority && (!oldestInCategory || voice.startedAt < oldestInCategory->startedAt)) {
+                    oldestInCategory = &voice;
+                }
+            }
+            if (voice.priority <= priority && (!cheapestVoice || voice.priority < cheapestVoice->priority ||
+                (voice.priority == cheapestVoice->priority && voice.startedAt < cheapestVoice->startedAt))) {
+                cheapestVoice = &voice;
+            }
+        }
+
+        if (activeInCategory >= categoryLimits[category]) {
+            target = oldestInCategory;
+        } else {
+            target = freeVoice ? freeVoice : cheapestVoice;
+        }
+        if (!target) return false;
+
+        start(*target, buffer, category, priority, volume, pitch);
+        frameCues[cuesThisFrame++] = FrameCue{&buffer, category, priority, target, target->startedAt};
+        return true;
+    }
+
+    void stopAll() {
+        for (Voice& voice : voices) voice.sound.stop();
+    }
+
+private:
+    struct Voice {
+        sf::Sound sound;
+        SoundCategory category = SoundPickup;
+        int priority = 0;
+        uint64_t startedAt = 0;
+    };
+
+    // A cue played this frame; startedAt tells whether its voice has since
+    // been stolen by another cue.
+    struct FrameCue {
+        const sf::SoundBuffer* buffer;
+        SoundCategory category;
+        int priority;
+        Voice* voice;
+        uint64_t startedAt;
+    };
+
+    void start(Voice& voice, const sf::SoundBuffer& buffer, SoundCategory category, int priority, float volume, float pitch) {
+        voice.sound.stop();
+        if (voice.sound.getBuffer() != &buffer) voice.sound.setBuffer(buffer);
+        voice.sound.setVolume(volume);
+        voice.sound.setPitch(pitch);
+        voice.category = category;
+        voice.priority = priority;
+        voice.startedAt = ++playCounter;
+        voice.sound.play();
+    }
+
+    std::vector<Voice> voices;
+    int categoryLimits[SoundCategoryCount];
+    FrameCue frameCues[MAX_CUES_PER_FRAME];
+    size_t cuesThisFrame = 0;
+    uint64_t playCounter = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Single-producer, single-consumer queue of length-prefixed byte records in
+// a power-of-two ring. Neither side ever waits for the other: push() fails
+// when the record does not fit, pop() fails when the queue is empty.
+class SpscRecordQueue {
+public:
+    explicit SpscRecordQueue(size_t capacity) {
+        size_t size = 1024;
+        while (size < capacity) size <<= 1;
+        buffer.resize(size);
+        mask = size - 1;
+    }
+
+    bool push(const uint8_t* data, uint32_t size) {
+        size_t tail = writePos.load(std::memory_order_relaxed);
+        size_t head = readPos.load(std::memory_order_acquire);
+        if (buffer.size() - (tail - head) < sizeof(size) + size) return false;
+        copyIn(tail, reinterpret_cast<const uint8_t*>(&size), sizeof(size));
+        copyIn(tail + sizeof(size), data, size);
+        writePos.store(tail + sizeof(size) + size, std::memory_order_release);
+        return true;
+    }
+
+    // Appends the next record to out.
+    bool pop(std::vector<uint8_t>& out) {
+        size_t head = readPos.load(std::memory_order_relaxed);
+        size_t tail = writePos.load(std::memory_order_acquire);
+        if (head == tail) return false;
+        uint32_t size = 0;
+        copyOut(head, reinterpret_cast<uint8_t*>(&size), sizeof(size));
+        size_t start = out.size();
+        out.resize(start + size);
+        copyOut(head + sizeof(size), out.data() + start, size);
+        readPos.store(head + sizeof(size) + size, std::memory_order_release);
+        return true;
+    }
+
+private:
+    void copyIn(size_t position, const uint8_t* data, size_t size) {
+        size_t offset = position & mask;
+        size_t first = std::min(size, buffer.size() - offset);
+        std::memcpy(buffer.data() + offset, data, first);
+        std::memcpy(buffer.data(), data + first, size - first);
+    }
+
+    void copyOut(size_t position, uint8_t* data, size_t size) const {
+        size_t offset = position & mask;
+        size_t first = std::min(size, buffer.size() - offset);
+        std::memcpy(data, buffer.data() + offset, first);
+        std::memcpy(data + first, buffer.data(), size - first);
+    }
+
+    std::vector<uint8_t> buffer;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> readPos{0};
+    alignas(64) std::atomic<size_t> writePos{0};
+};
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include "GameSim.h"
+#include "SpscQueue.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#define RAT_RIDER_POSIX_STREAM 1
+#endif
+
+
+enum StreamRecordType : uint8_t { StreamRoundStart = 1, StreamTick = 2 };
+
+static constexpr uint32_t STATE_STREAM_VERSION = 1;
+
+
+// Publishes one compact binary record per tick for dashboards, spectators
+// and analysis scripts. The game thread encodes the record and pushes it
+// into an SpscRecordQueue; a writer thread moves records to the output. If
+// the writer falls behind, records are dropped and counted rather than
+// stalling the frame, and the next tick is preceded by a resync.
+//
+// Stream: "RRST", u32 version, then records of u16 size (bytes after the
+// size field), u8 type and the payload. Numbers are in host byte order,
+// floats are IEEE single precision, positions in pixels, speeds in px/s.
+//   RoundStart: u8 mode, u32 seed, f32 window width and height,
+//     f32 platform height, player width and height, collectible radius.
+//   Tick: u32 tick, f32 game time, i32 score, f32 block speed,
+//     u8 flags (1 round over, 2 raining magenta), u8 winner,
+//     u8 platform effect, f32 effect time, f32 magenta rain time,
+//     u8 n then per player: u8 slot, u8 flags (1 alive, 2 grounded, 4 has a body), f32 x y vx vy,
+//     u8 n then per new platform: u32 id, f32 x y length vx,
+//     u8 n then per removed platform: u32 id,
+//     u8 n then per new collectible: u32 id, u8 type, f32 x y vx vy,
+//     u8 n then per pickup: u32 id, u8 type,
+//     u8 n then per collectible gone without a pickup: u32 id.
+// Platforms and collectibles move at a constant velocity between spawn
+// and removal, so a client can place them from the spawn record alone.
+//
+// A listener on a Unix socket may connect at any time. It gets the header,
+// possibly the tail of ticks already queued, then a fresh RoundStart that
+// re-announces every platform and collectible on screen as new. Clients
+// reset their view on every RoundStart and ignore ticks before the first.
+class StateStream {
+public:
+    StateStream() = default;
+    ~StateStream() { close(); }
+
+    StateStream(const StateStream&) = delete;
+    StateStream& operator=(const StateStream&) = delete;
+
+    // "unix:<path>" listens on a Unix socket; anything else is opened for
+    // writing, e.g. a FIFO made with mkfifo or a plain file.
+    bool open(const std::string& target, size_t queueBytes = 1 << 20) {
+#ifdef RAT_RIDER_POSIX_STREAM
+        close();
+        // A reader going away must not kill the game.
+        signal(SIGPIPE, SIG_IGN);
+        if (target.compare(0, 5, "unix:") == 0) {
+            std::string path = target.substr(5);
+            listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un address;
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (listenFd < 0 || path.size() >= sizeof(address.sun_path)) {
+                std::cerr << "Error creating state stream socket '" << path << "'" << std::endl;
+                close();
+                return false;
+            }
+            std::memcpy(address.sun_path, path.c_str(), path.size());
+            unlink(path.c_str());
+            if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 4) != 0) {
+                std::cerr << "Error listening on state stream socket '" << path << "'" << std::endl;
+                close();
+                return false;
+            }
+            fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL, 0) | O_NONBLOCK);
+            socketPath = path;
+        } else {
+            filePath = target;
+        }
+        queue.reset(new SpscRecordQueue(queueBytes));
+        stopWriter = false;
+        writerThread = std::thread(&StateStream::writerLoop, this);
+        return true;
+#else
+        (void)target; (void)queueBytes;
+        std::cerr << "Error: the state stream needs POSIX I/O" << std::endl;
+        return false;
+#endif
+    }
+
+    void close() {
+        if (writerThread.joinable()) {
+            stopWriter = true;
+            writerWake.notify_one();
+            writerThread.join();
+        }
+#ifdef RAT_RIDER_POSIX_STREAM
+        if (listenFd >= 0) ::close(listenFd);
+        listenFd = -1;
+        if (!socketPath.empty()) unlink(socketPath.c_str());
+#endif
+        socketPath.clear();
+        filePath.clear();
+        queue.reset();
+    }
+
+    bool isOpen() const { return queue != nullptr; }
+
+    // Game thread, once per tick. Encodes what changed since the last call.
+    void publish(const GameSim& sim) {
+        if (!queue) return;
+        bool newRound = !haveRound || sim.roundSeed != lastSeed || sim.gameTime < lastGameTime;
+        if (resyncRequested.exchange(false)) newRound = true;
+        if (newRound) {
+            encodeRoundStart(sim);
+            pushRecord();
+            previousPlatformIds.clear();
+            previousCollectibleIds.clear();
+            haveRound = true;
+            lastSeed = sim.roundSeed;
+        }
+        lastGameTime = sim.gameTime;
+        encodeTick(sim);
+        pushRecord();
+    }
+
+    uint64_t recordsPublished() const { return published; }
+    uint64_t recordsDropped() const { return dropped; }
+
+private:
+    void put8(uint8_t value) { record.push_back(value); }
+
+    template <typename T>
+    void put(T value) {
+        size_t at = record.size();
+        record.resize(at + sizeof(T));
+        std::memcpy(record.data() + at, &value, sizeof(T));
+    }
+
+    void beginRecord(StreamRecordType type) {
+        record.clear();
+        put<uint16_t>(0);
+        put8(type);
+    }
+
+    void pushRecord() {
+        uint16_t size = static_cast<uint16_t>(std::min<size_t>(record.size() - sizeof(uint16_t), 0xFFFF));
+        std::memcpy(record.data(), &size, sizeof(size));
+        if (queue->push(record.data(), static_cast<uint32_t>(record.size()))) {
+            published++;
+            writerWake.notify_one();
+        } else {
+            // The lost tick may have carried spawns; re-announce everything.
+            dropped++;
+            resyncRequested = true;
+        }
+    }
+
+    void encodeRoundStart(const GameSim& sim) {
+        beginRecord(StreamRoundStart);
+        put8(static_cast<uint8_t>(sim.mode));
+        put<uint32_t>(sim.roundSeed);
+        put<float>(sim.windowWidth);
+        put<float>(sim.windowHeight);
+        put<float>(sim.tun.fixedHeight);
+        put<float>(sim.tun.playerWidth);
+        put<float>(sim.tun.playerHeight);
+        put<float>(sim.tun.collectibleRadius);
+    }
+
+    // Reserves a count byte, returning its offset; the caller fills it in once
+    // the entries are written. Lists longer than 255 are cut short.
+    size_t beginList() {
+        put8(0);
+        return record.size() - 1;
+    }
+
+    void encodeTick(const GameSim& sim) {
+        beginRecord(StreamTick);
+        put<uint32_t>(tickCount++);
+        put<float>(sim.gameTime);
+        put<int32_t>(sim.score);
+        put<float>(sim.blockSpeed);
+        put8(static_cast<uint8_t>((sim.roundOver ? 1 : 0) | (sim.isRainingMagenta ? 2 : 0)));
+        put8(static_cast<uint8_t>(sim.winner));
+        put8(static_cast<uint8_t>(sim.currentPlatformEffect));
+        put<float>(sim.platformEffectTime);
+        put<float>(sim.magentaRainTime);
+
+        size_t count = beginList();
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+            const SimPlayer& player = sim.players[i];
+            if (!player.active) continue;
+            b2Vec2 velocity = player.body ? player.body->GetLinearVelocity() : b2Vec2(0.f, 0.f);
+            put8(static_cast<uint8_t>(i));
+            put8(static_cast<uint8_t>((player.alive ? 1 : 0) | (player.grounded ? 2 : 0) | (player.body ? 4 : 0)));
+            put<float>(player.x);
+            put<float>(player.y);
+            put<float>(velocity.x * PIXELS_PER_METER);
+            put<float>(velocity.y * PIXELS_PER_METER);
+            record[count]++;
+        }
+
+        // Both lists are in spawn order with rising ids, so new entries are the
+        // ones past the last id seen and removals fall out of a merge.
+        currentIds.clear();
+        for (const SimPlatform& platform : sim.platforms) currentIds.push_back(static_cast<uint32_t>(platform.id));
+        uint32_t lastPlatformId = previousPlatformIds.empty() ? 0 : previousPlatformIds.back();
+        count = beginList();
+        for (const SimPlatform& platform : sim.platforms) {
+            if (platform.id <= lastPlatformId) continue;
+            if (record[count] == 255) break;
+            put<uint32_t>(static_cast<uint32_t>(platform.id));
+            put<float>(platform.x);
+            put<float>(platform.y);
+            put<float>(platform.length);
+            put<float>(platform.body->GetLinearVelocity().x * PIXELS_PER_METER);
+            record[count]++;
+        }
+        writeRemovals(previousPlatformIds, currentIds, nullptr);
+        previousPlatformIds.swap(currentIds);
+
+        currentIds.clear();
+        for (const SimCollectible& collectible : sim.collectibles) currentIds.push_back(collectible.id);
+        uint32_t lastCollectibleId = previousCollectibleIds.empty() ? 0 : previousCollectibleIds.back();
+        count = beginList();
+        for (const SimCollectible& collectible : sim.collectibles) {
+            if (collectible.id <= lastCollectibleId) continue;
+            if (record[count] == 255) break;
+            b2Vec2 velocity = collectible.body->GetLinearVelocity();
+            put<uint32_t>(collectible.id);
+            put8(static_cast<uint8_t>(collectible.type));
+            put<float>(collectible.x);
+            put<float>(collectible.y);
+            put<float>(velocity.x * PIXELS_PER_METER);
+            put<float>(velocity.y * PIXELS_PER_METER);
+            record[count]++;
+        }
+        count = beginList();
+        for (size_t i = 0; i < sim.events.pickupIds.size() && record[count] < 255; i++) {
+            put<uint32_t>(sim.events.pickupIds[i]);
+            put8(static_cast<uint8_t>(sim.events.pickups[i]));
+            record[count]++;
+        }
+        writeRemovals(previousCollectibleIds, currentIds, &sim.events.pickupIds);
+        previousCollectibleIds.swap(currentIds);
+    }
+
+    // Writes the ids in previous that are missing from current, skipping any in `except`.
+    void writeRemovals(const std::vector<uint32_t>& previous, const std::vector<uint32_t>& current, const std::vector<uint32_t>* except) {
+        size_t count = beginList();
+        size_t j = 0;
+        for (uint32_t id : previous) {
+            while (j < current.size() && current[j] < id) j++;
+            if (j < current.size() && current[j] == id) continue;
+            if (except && std::find(except->begin(), except->end(), id) != except->end()) continue;
+            if (record[count] == 255) break;
+            put<uint32_t>(id);
+            record[count]++;
+        }
+    }
+
+    void writerLoop() {
+#ifdef RAT_RIDER_POSIX_STREAM
+        std::vector<int> clients;
+        bool fileOpen = false;
+        std::vector<uint8_t> batch;
+        while (true) {
+            if (!filePath.empty() && !fileOpen) {
+                // Non-blocking, so a FIFO with no reader yet fails with ENXIO
+                // instead of holding up shutdown; it is retried every pass.
+                // It stays non-blocking for writeAll().
+                int fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+                if (fd >= 0) {
+                    fileOpen = true;
+                    if (sendHeader(fd)) {
+                        clients.push_back(fd);
+                        resyncRequested = true;
+                    }
+                } else if (errno != ENXIO) {
+                    std::cerr << "Error opening state stream '" << filePath << "'" << std::endl;
+                    fileOpen = true;
+                }
+            }
+            if (listenFd >= 0) {
+                int client;
+                while ((client = accept(listenFd, nullptr, nullptr)) >= 0) {
+                    fcntl(client, F_SETFL, fcntl(client, F_GETFL, 0) | O_NONBLOCK);
+                    if (sendHeader(client)) {
+                        clients.push_back(client);
+                        resyncRequested = true;
+                    }
+                }
+            }
+
+            // With nobody listening, records are popped and discarded.
+            batch.clear();
+            while (batch.size() < 64 * 1024 && queue->pop(batch)) {}
+            if (!batch.empty()) {
+                for (size_t i = 0; i < clients.size();) {
+                    if (writeAll(clients[i], batch.data(), batch.size())) {
+                        i++;
+                    } else {
+                        ::close(clients[i]);
+                        clients.erase(clients.begin() + i);
+                    }
+                }
+                continue;
+            }
+            if (stopWriter) break;
+            std::unique_lock<std::mutex> lock(writerMutex);
+            // The producer notifies without the lock, so a wakeup can be
+            // missed; the timeout bounds the delay that causes.
+            writerWake.wait_for(lock, std::chrono::milliseconds(5));
+        }
+        for (int fd : clients) ::close(fd);
+#endif
+    }
+
+#ifdef RAT_RIDER_POSIX_STREAM
+    bool sendHeader(int fd) {
+        uint8_t header[8];
+        std::memcpy(header, "RRST", 4);
+        uint32_t version = STATE_STREAM_VERSION;
+        std::memcpy(header + 4, &version, sizeof(version));
+        if (!writeAll(fd, header, sizeof(header))) {
+            ::close(fd);
+            return false;
+        }
+        return true;
+    }
+
+    // Every fd is non-blocking, so a reader that stops reading cannot wedge
+    // the writer inside write() and hang close(). While the stream is open
+    // a full pipe is waited out; once close() asks the writer to stop, a
+    // reader gets 100 ms to make room before it is dropped.
+    bool writeAll(int fd, const uint8_t* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::write(fd, data, size);
+            if (n > 0) {
+                data += n;
+                size -= static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                pollfd writable = { fd, POLLOUT, 0 };
+                bool stopping = stopWriter;
+                if (poll(&writable, 1, stopping ? 100 : 50) <= 0 && stopping) return false;
+                continue;
+            }
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    std::unique_ptr<SpscRecordQueue> queue;
+    std::vector<uint8_t> record;
+    std::vector<uint32_t> previousPlatformIds;
+    std::vector<uint32_t> previousCollectibleIds;
+    std::vector<uint32_t> currentIds;
+    bool haveRound = false;
+    uint32_t lastSeed = 0;
+    float lastGameTime = 0.f;
+    uint32_t tickCount = 0;
+    uint64_t published = 0;
+    uint64_t dropped = 0;
+
+    std::atomic<bool> resyncRequested{false};   // a listener joined or a record was dropped
+
+    std::string socketPath;
+    std::string filePath;
+    int listenFd = -1;
+    std::thread writerThread;
+    std::atomic<bool> stopWriter{false};
+    std::mutex writerMutex;
+    std::condition_variable writerWake;
+};
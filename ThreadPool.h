@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+
+// Fixed set of worker threads for fork-join loops. parallelFor hands out
+// indices [0, count) one at a time; the calling thread works too and the
+// call returns once every index is done. Only one parallelFor runs at once.
+class ThreadPool {
+public:
+    // threadCount includes the calling thread, so 1 means run everything inline.
+    explicit ThreadPool(size_t threadCount) {
+        for (size_t i = 1; i < threadCount; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopWorkers = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+
+    void parallelFor(size_t count, const std::function<void(size_t)>& body) {
+        if (workers.empty() || count <= 1) {
+            for (size_t i = 0; i < count; i++) body(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &body;
+            jobCount = count;
+            nextIndex = 0;
+            busyWorkers = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        runIndices(body, count);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    void runIndices(const std::function<void(size_t)>& body, size_t count) {
+        for (size_t i = nextIndex.fetch_add(1); i < count; i = nextIndex.fetch_add(1)) {
+            body(i);
+        }
+    }
+
+    void workerLoop() {
+        uint64_t seenGeneration = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopWorkers || generation != seenGeneration; });
+            if (stopWorkers) break;
+            seenGeneration = generation;
+            const std::function<void(size_t)>* body = job;
+            size_t count = jobCount;
+            lock.unlock();
+            runIndices(*body, count);
+            lock.lock();
+            if (--busyWorkers == 0) done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextIndex{0};
+    size_t busyWorkers = 0;
+    uint64_t generation = 0;
+    bool stopWorkers = false;
+};
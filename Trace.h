@@ -0,0 +1,212 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include "SpscQueue.h"
+
+// Records frame phases and counters as Chrome trace events, for opening in
+// chrome://tracing or ui.perfetto.dev.
+//
+// Each thread that records gets its own SpscRecordQueue the first time it
+// does, so recording takes no lock: a TraceScope costs two clock reads and
+// one push, and a disabled tracer costs one relaxed load. A flusher thread
+// turns the queued events into JSON and writes the file. Events that do not
+// fit in a full ring are dropped and counted.
+//
+// Names must be string literals (or otherwise outlive the trace): only the
+// pointer is queued.
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static bool enabled() { return instance().recording.load(std::memory_order_relaxed); }
+
+    // Starts writing to path; stops by itself after maxSeconds.
+    bool start(const std::string& path, double maxSeconds = 30.0) {
+        stop();
+        out.open(path, std::ios::trunc);
+        if (!out) {
+            std::cerr << "Error opening trace file '" << path << "'" << std::endl;
+            return false;
+        }
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        firstEvent = true;
+        dropped = 0;
+        written = 0;
+        origin = std::chrono::steady_clock::now();
+        limitMicros = static_cast<int64_t>(maxSeconds * 1e6);
+        stopFlusher = false;
+        flusher = std::thread(&Tracer::flushLoop, this);
+        recording = true;
+        return true;
+    }
+
+    // Writes what is still queued and closes the file.
+    void stop() {
+        recording = false;
+        if (!flusher.joinable()) return;
+        stopFlusher = true;
+        flushWake.notify_one();
+        flusher.join();
+        out << "\n]}\n";
+        out.close();
+        std::cout << "Trace: " << written << " events written, " << dropped << " dropped" << std::endl;
+    }
+
+    // Names the calling thread's lane in the viewer.
+    void nameThread(const char* name) {
+        if (!enabled()) return;
+        push(Event{ name, 'M', 0, 0 });
+    }
+
+    void complete(const char* name, int64_t startMicros, int64_t endMicros) {
+        push(Event{ name, 'X', startMicros, endMicros - startMicros });
+    }
+
+    void counter(const char* name, int64_t value) {
+        if (!enabled()) return;
+        push(Event{ name, 'C', now(), value });
+    }
+
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    ~Tracer() { stop(); }
+
+private:
+    struct Event {
+        const char* name;
+        char phase;             // 'X' complete, 'C' counter, 'M' thread name
+        int64_t timestamp;      // microseconds since start()
+        int64_t value;          // duration for 'X', value for 'C'
+    };
+
+    struct Lane {
+        Lane(uint32_t id) : queue(1 << 20), id(id) {}
+        SpscRecordQueue queue;
+        uint32_t id;
+    };
+
+    Tracer() = default;
+
+    void push(const Event& event) {
+        // Rings are kept for the life of the program, so a thread's pointer
+        // stays valid across stop() and start().
+        thread_local Lane* lane = nullptr;
+        if (!lane) {
+            std::lock_guard<std::mutex> lock(lanesMutex);
+            lanes.emplace_back(new Lane(static_cast<uint32_t>(lanes.size() + 1)));
+            lane = lanes.back().get();
+        }
+        if (!lane->queue.push(reinterpret_cast<const uint8_t*>(&event), sizeof(event))) dropped++;
+    }
+
+    void flushLoop() {
+        std::vector<uint8_t> scratch;
+        std::vector<Lane*> snapshot;
+        while (true) {
+            bool finishing = stopFlusher;
+            {
+                std::lock_guard<std::mutex> lock(lanesMutex);
+                snapshot.clear();
+                for (auto& lane : lanes) snapshot.push_back(lane.get());
+            }
+            for (Lane* lane : snapshot) {
+                scratch.clear();
+                while (lane->queue.pop(scratch)) {
+                    Event event;
+                    std::memcpy(&event, scratch.data(), sizeof(event));
+                    scratch.clear();
+                    writeEvent(event, lane->id);
+                }
+            }
+            if (finishing) break;
+            if (now() >= limitMicros) recording = false;
+            std::unique_lock<std::mutex> lock(flushMutex);
+            flushWake.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        out.flush();
+    }
+
+    void writeEvent(const Event& event, uint32_t tid) {
+        out << (firstEvent ? "" : ",\n");
+        firstEvent = false;
+        written++;
+        if (event.phase == 'M') {
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << event.name << "\"}}";
+        } else if (event.phase == 'C') {
+            out << "{\"name\":\"" << event.name << "\",\"ph\":\"C\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << event.timestamp << ",\"args\":{\"value\":" << event.value << "}}";
+        } else {
+            out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << event.timestamp << ",\"dur\":" << event.value << "}";
+        }
+    }
+
+    std::atomic<bool> recording{false};
+    std::atomic<bool> stopFlusher{false};
+    std::atomic<uint64_t> dropped{0};
+    uint64_t written = 0;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    int64_t limitMicros = 0;
+
+    std::mutex lanesMutex;      // guards the list, not the rings
+    std::vector<std::unique_ptr<Lane>> lanes;
+
+    std::ofstream out;
+    bool firstEvent = true;
+    std::thread flusher;
+    std::mutex flushMutex;
+    std::condition_variable flushWake;
+};
+
+// Name of the innermost TraceScope open on the calling thread, or nullptr.
+// Kept whether or not a trace is being recorded, so allocations can be
+// attributed to phases (see Counters.h).
+inline const char*& currentTracePhase() {
+    thread_local const char* phase = nullptr;
+    return phase;
+}
+
+// Times the enclosing block as one trace event and marks it as the
+// thread's current phase.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : name(name), previous(currentTracePhase()), start(Tracer::enabled() ? Tracer::instance().now() : -1) {
+        currentTracePhase() = name;
+    }
+
+    ~TraceScope() { end(); }
+
+    // Ends the event early, for phases that do not fill a whole block.
+    void end() {
+        if (!name) return;
+        if (start >= 0) Tracer::instance().complete(name, start, Tracer::instance().now());
+        currentTracePhase() = previous;
+        name = nullptr;
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    const char* previous;
+    int64_t start;
+};
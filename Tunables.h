@@ -0,0 +1,327 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <sys/stat.h>
+#include "AtomicFile.h"
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+
+// Every gameplay tunable, in the order it is stored in the struct.
+// X(type, name, default value)
+#define RAT_RIDER_TUNABLES(X) \
+    X(float, gravity, 7.0f) \
+    X(float, fixedHeight, 20.f) \
+    X(float, baseMinLength, 100.f) \
+    X(float, baseMaxLength, 300.f) \
+    X(float, platformMinYOffset, 450.f) \
+    X(float, platformMaxYOffset, 150.f) \
+    X(float, startBlockSpeed, 200.f) \
+    X(float, blockSpeedIncreaseFactor, 5.0f) \
+    X(float, maxBlockSpeed, 600.f) \
+    X(float, startMinSpawnTime, 2.5f) \
+    X(float, startMaxSpawnTime, 3.5f) \
+    X(float, minSpawnTimeBase, 0.8f) \
+    X(float, maxSpawnTimeBase, 1.5f) \
+    X(float, playerWidth, 60.f) \
+    X(float, playerHeight, 80.f) \
+    X(float, playerJumpForce, 500.0f) \
+    X(int, maxJumps, 2) \
+    X(float, jumpBufferTime, 0.1f) \
+    X(float, coyoteTime, 0.1f) \
+    X(float, fastFallGravityScale, 100.0f) \
+    X(float, collectibleRadius, 25.f) \
+    X(float, collectibleSpawnChance, 0.85f) \
+    X(float, magentaCollectibleProb, 0.35f) \
+    X(float, orangeCollectibleProb, 0.20f) \
+    X(float, greenCollectibleProb, 0.125f) \
+    X(float, redCollectibleProb, 0.125f) \
+    X(float, whiteCollectibleProb, 0.05f) \
+    X(float, minusScoreCollectibleProb, 0.15f) \
+    X(int, magentaScore, 1) \
+    X(int, orangeScore, 3) \
+    X(int, minusScorePenalty, 2) \
+    X(float, platformEffectDuration, 10.0f) \
+    X(float, lengthenFactor, 2.0f) \
+    X(float, shortenFactor, 0.5f) \
+    X(float, magentaRainDuration, 10.0f) \
+    X(float, magentaRainSpawnInterval, 0.15f) \
+    X(float, magentaRainSpeed, 400.0f) \
+    X(float, platformOverlapMargin, 50.f)
+
+
+// Flat, trivially copyable block of gameplay constants. Hot code reads it
+// directly; the binary cache is just a copy of these bytes.
+struct Tunables {
+#define RAT_RIDER_TUNABLE_FIELD(type, name, value) type name = value;
+    RAT_RIDER_TUNABLES(RAT_RIDER_TUNABLE_FIELD)
+#undef RAT_RIDER_TUNABLE_FIELD
+};
+
+
+// Changes whenever a field is added, removed, renamed or retyped, so a stale
+// binary cache is never reinterpreted with the wrong layout.
+inline uint32_t tunablesLayoutHash() {
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const char* text) {
+        for (; *text; ++text) {
+            hash ^= static_cast<unsigned char>(*text);
+            hash *= 16777619u;
+        }
+        hash ^= ';';
+        hash *= 16777619u;
+    };
+#define RAT_RIDER_TUNABLE_HASH(type, name, value) mix(#type); mix(#name);
+    RAT_RIDER_TUNABLES(RAT_RIDER_TUNABLE_HASH)
+#undef RAT_RIDER_TUNABLE_HASH
+    return hash ^ static_cast<uint32_t>(sizeof(Tunables));
+}
+
+
+struct TunablesCacheHeader {
+    char magic[4];
+    uint32_t layoutHash;
+    int64_t sourceSize;
+    int64_t sourceMTime;
+};
+
+inline bool statTunablesSource(const std::string& filename, int64_t& size, int64_t& mtime) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) return false;
+    size = static_cast<int64_t>(info.st_size);
+#ifdef __linux__
+    mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+#else
+    mtime = static_cast<int64_t>(info.st_mtime);
+#endif
+    return true;
+}
+
+inline bool setTunable(Tunables& tunables, const std::string& key, const std::string& value) {
+    const char* text = value.c_str();
+    char* end = nullptr;
+#define RAT_RIDER_TUNABLE_PARSE(type, name, def) \
+    if (key == #name) { \
+        double parsed = std::strtod(text, &end); \
+        if (end == text) return false; \
+        tunables.name = static_cast<type>(parsed); \
+        return true; \
+    }
+    RAT_RIDER_TUNABLES(RAT_RIDER_TUNABLE_PARSE)
+#undef RAT_RIDER_TUNABLE_PARSE
+    return false;
+}
+
+// Parses "key = value" lines; '#' starts a comment. Missing keys keep their defaults.
+inline Tunables parseTunablesText(std::istream& in, const std::string& filename) {
+    Tunables tunables;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                std::cerr << filename << ":" << lineNumber << ": expected 'key = value'" << std::endl;
+            }
+            continue;
+        }
+        std::string key, value;
+        std::istringstream(line.substr(0, equals)) >> key;
+        std::istringstream(line.substr(equals + 1)) >> value;
+        if (!setTunable(tunables, key, value)) {
+            std::cerr << filename << ":" << lineNumber << ": unknown key or bad value '" << key << "'" << std::endl;
+        }
+    }
+    return tunables;
+}
+
+// Reports every value the game cannot run with: sizes and times that must
+// be positive, min/max pairs the wrong way round (their random ranges would
+// be inverted), a maxBlockSpeed that is not above startBlockSpeed (the
+// spawn window is scaled by their difference), and a gravity or jump force
+// that is not positive (the jump envelope divides by both). Returns false if
+// any is found.
+inline bool validateTunables(const Tunables& t, const std::string& filename) {
+    bool valid = true;
+    auto check = [&](bool ok, const char* problem) {
+        if (!ok) {
+            std::cerr << filename << ": " << problem << std::endl;
+            valid = false;
+        }
+    };
+    check(t.gravity > 0.f, "gravity must be positive");
+    check(t.fixedHeight > 0.f, "fixedHeight must be positive");
+    check(t.baseMinLength > 0.f, "baseMinLength must be positive");
+    check(t.baseMinLength <= t.baseMaxLength, "baseMinLength must not exceed baseMaxLength");
+    check(t.platformMaxYOffset <= t.platformMinYOffset, "platformMaxYOffset must not exceed platformMinYOffset");
+    check(t.startBlockSpeed > 0.f, "startBlockSpeed must be positive");
+    check(t.blockSpeedIncreaseFactor >= 0.f, "blockSpeedIncreaseFactor must not be negative");
+    check(t.maxBlockSpeed > t.startBlockSpeed, "maxBlockSpeed must be above startBlockSpeed");
+    check(t.startMinSpawnTime > 0.f, "startMinSpawnTime must be positive");
+    check(t.startMinSpawnTime <= t.startMaxSpawnTime, "startMinSpawnTime must not exceed startMaxSpawnTime");
+    check(t.minSpawnTimeBase > 0.f, "minSpawnTimeBase must be positive");
+    check(t.minSpawnTimeBase <= t.maxSpawnTimeBase, "minSpawnTimeBase must not exceed maxSpawnTimeBase");
+    check(t.playerWidth > 0.f && t.playerHeight > 0.f, "playerWidth and playerHeight must be positive");
+    check(t.playerJumpForce > 0.f, "playerJumpForce must be positive");
+    check(t.maxJumps >= 0, "maxJumps must not be negative");
+    check(t.jumpBufferTime >= 0.f, "jumpBufferTime must not be negative");
+    check(t.fastFallGravityScale >= 0.f, "fastFallGravityScale must not be negative");
+    check(t.collectibleRadius > 0.f, "collectibleRadius must be positive");
+    check(t.magentaCollectibleProb >= 0.f && t.orangeCollectibleProb >= 0.f && t.greenCollectibleProb >= 0.f &&
+          t.redCollectibleProb >= 0.f && t.whiteCollectibleProb >= 0.f && t.minusScoreCollectibleProb >= 0.f,
+          "collectible probabilities must not be negative");
+    check(t.platformEffectDuration >= 0.f && t.magentaRainDuration >= 0.f, "effect durations must not be negative");
+    check(t.lengthenFactor > 0.f && t.shortenFactor > 0.f, "lengthenFactor and shortenFactor must be positive");
+    check(t.magentaRainSpawnInterval > 0.f, "magentaRainSpawnInterval must be positive");
+    check(t.platformOverlapMargin >= 0.f, "platformOverlapMargin must not be negative");
+    return valid;
+}
+
+inline bool readTunablesCache(const std::string& cacheFilename, int64_t sourceSize, int64_t sourceMTime, Tunables& tunables) {
+    std::ifstream cache(cacheFilename, std::ios::binary);
+    if (!cache.is_open()) return false;
+    TunablesCacheHeader header;
+    if (!cache.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if (std::memcmp(header.magic, "RRTN", 4) != 0 || header.layoutHash != tunablesLayoutHash() ||
+        header.sourceSize != sourceSize || header.sourceMTime != sourceMTime) {
+        return false;
+    }
+    Tunables cached;
+    if (!cache.read(reinterpret_cast<char*>(&cached), sizeof(cached))) return false;
+    tunables = cached;
+    return true;
+}
+
+inline void writeTunablesCache(const std::string& cacheFilename, int64_t sourceSize, int64_t sourceMTime, const Tunables& tunables) {
+    TunablesCacheHeader header;
+    std::memcpy(header.magic, "RRTN", 4);
+    header.layoutHash = tunablesLayoutHash();
+    header.sourceSize = sourceSize;
+    header.sourceMTime = sourceMTime;
+    char image[sizeof(header) + sizeof(tunables)];
+    std::memcpy(image, &header, sizeof(header));
+    std::memcpy(image + sizeof(header), &tunables, sizeof(tunables));
+    if (!writeFileAtomically(cacheFilename, image, sizeof(image))) {
+        std::cerr << "Error writing tunables cache '" << cacheFilename << "'" << std::endl;
+    }
+}
+
+// Reads the tunables into `tunables`, preferring "<filename>.bin" when it
+// matches the text file's size and modification time. Returns false, leaving
+// `tunables` as it was, if the file is missing or unreadable or any value
+// fails validateTunables(); a hot reload keeps the values it had.
+inline bool tryLoadTunables(const std::string& filename, Tunables& tunables, bool useCache = true) {
+    int64_t size = 0, mtime = 0;
+    if (!statTunablesSource(filename, size, mtime)) {
+        std::cerr << "Tunables file '" << filename << "' not found" << std::endl;
+        return false;
+    }
+    std::string cacheFilename = filename + ".bin";
+    Tunables loaded;
+    if (useCache && readTunablesCache(cacheFilename, size, mtime, loaded) && validateTunables(loaded, cacheFilename)) {
+        tunables = loaded;
+        return true;
+    }
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error opening tunables file '" << filename << "'" << std::endl;
+        return false;
+    }
+    loaded = parseTunablesText(file, filename);
+    if (!validateTunables(loaded, filename)) return false;
+    writeTunablesCache(cacheFilename, size, mtime, loaded);
+    tunables = loaded;
+    return true;
+}
+
+// As tryLoadTunables(), falling back to the defaults.
+inline Tunables loadTunables(const std::string& filename, bool useCache = true) {
+    Tunables tunables;
+    if (!tryLoadTunables(filename, tunables, useCache)) std::cerr << "Using default tunables" << std::endl;
+    return tunables;
+}
+
+
+// Watches the tunables file for edits. On Linux this is an inotify watch on the
+// containing directory (editors usually save by renaming a temp file over the
+// original); elsewhere it falls back to comparing the modification time.
+class TunablesWatcher {
+public:
+    explicit TunablesWatcher(const std::string& filename) : filename(filename) {
+        size_t slash = filename.find_last_of('/');
+        directory = (slash == std::string::npos) ? "." : filename.substr(0, slash);
+        basename = (slash == std::string::npos) ? filename : filename.substr(slash + 1);
+        statTunablesSource(filename, lastSize, lastMTime);
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd >= 0) {
+            watchFd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            if (watchFd < 0) {
+                close(inotifyFd);
+                inotifyFd = -1;
+            }
+        }
+#endif
+    }
+
+    ~TunablesWatcher() {
+#ifdef __linux__
+        if (inotifyFd >= 0) close(inotifyFd);
+#endif
+    }
+
+    TunablesWatcher(const TunablesWatcher&) = delete;
+    TunablesWatcher& operator=(const TunablesWatcher&) = delete;
+
+    // Non-blocking; returns true once per batch of changes to the watched file.
+    bool poll() {
+#ifdef __linux__
+        if (inotifyFd >= 0) {
+            bool changed = false;
+            alignas(inotify_event) char buffer[4096];
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* ptr = buffer; ptr < buffer + length; ) {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                    if (event->len > 0 && basename == event->name) changed = true;
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+            return changed && refreshStat();
+        }
+#endif
+        return refreshStat();
+    }
+
+private:
+    bool refreshStat() {
+        int64_t size = 0, mtime = 0;
+        if (!statTunablesSource(filename, size, mtime)) return false;
+        if (size == lastSize && mtime == lastMTime) return false;
+        lastSize = size;
+        lastMTime = mtime;
+        return true;
+    }
+
+    std::string filename;
+    std::string directory;
+    std::string basename;
+    int64_t lastSize = -1;
+    int64_t lastMTime = -1;
+#ifdef __linux__
+    int inotifyFd = -1;
+    int watchFd = -1;
+#endif
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <iostream>
+#include <algorithm>
+#include "GameSim.h"
+
+
+// Draws every platform in one draw call and every collectible in another.
+// Platforms (the pillar under each block, then the block) are untextured
+// triangles, each outline a slightly larger black quad underneath. The
+// collectible textures are packed side by side into one atlas. build()
+// writes each body's quad straight from the pixel positions GameSim synced
+// after its last step, blended between the last two ticks.
+class WorldBatch {
+public:
+    static constexpr int COLLECTIBLE_TYPES = 6;
+
+    bool init(const sf::Texture* collectibleTextures, float collectibleRadius,
+              sf::Color defaultColor, sf::Color lengthenColor, sf::Color shortenColor) {
+        sf::Image images[COLLECTIBLE_TYPES];
+        unsigned int width = 0, height = 0;
+        for (int i = 0; i < COLLECTIBLE_TYPES; i++) {
+            images[i] = collectibleTextures[i].copyToImage();
+            width += images[i].getSize().x;
+            height = std::max(height, images[i].getSize().y);
+        }
+        sf::Image atlasImage;
+        atlasImage.create(width, height, sf::Color::Transparent);
+        unsigned int left = 0;
+        for (int i = 0; i < COLLECTIBLE_TYPES; i++) {
+            sf::Vector2u size = images[i].getSize();
+            atlasImage.copy(images[i], left, 0);
+            frames[i] = sf::FloatRect(static_cast<float>(left), 0.f, static_cast<float>(size.x), static_cast<float>(size.y));
+            left += size.x;
+        }
+        if (!atlas.loadFromImage(atlasImage)) {
+            std::cerr << "Error building collectible texture atlas" << std::endl;
+            return false;
+        }
+        radius = collectibleRadius;
+        effectColors[PlatformEffect::None] = defaultColor;
+        effectColors[PlatformEffect::Lengthen] = lengthenColor;
+        effectColors[PlatformEffect::Shorten] = shortenColor;
+        // Room for the busiest screen, as GameSim reserves for its bodies.
+        platformVertices.setPrimitiveType(sf::Triangles);
+        platformVertices.resize(32 * QUADS_PER_PLATFORM * 6);
+        collectibleVertices.setPrimitiveType(sf::Triangles);
+        collectibleVertices.resize(128 * 6);
+        return true;
+    }
+
+    // Rebuilds both vertex arrays, alpha of the way from each body's
+    // previous position to its current one. Collectibles are only drawn in
+    // single player.
+    void build(const GameSim& sim, float alpha) {
+        const sf::FloatRect untextured;
+        const float outline = 2.5f;
+        const float pillarHalfWidth = 7.5f, pillarLength = 500.f;
+        const sf::Color outlineColor = sf::Color::Black;
+        const sf::Color pillarColor(150, 150, 150);
+        float halfHeight = sim.tun.fixedHeight / 2.f;
+
+        size_t needed = sim.platforms.size() * QUADS_PER_PLATFORM * 6;
+        if (platformVertices.getVertexCount() < needed) platformVertices.resize(needed);
+        platformVertexCount = 0;
+        for (const SimPlatform& platform : sim.platforms) {
+            float x = lerp(platform.prevX, platform.x, alpha);
+            float y = lerp(platform.prevY, platform.y, alpha);
+            float halfLength = platform.length / 2.f;
+            float bottom = y + halfHeight;
+            putQuad(platformVertices, platformVertexCount, x - pillarHalfWidth - outline, bottom - outline,
+                    x + pillarHalfWidth + outline, bottom + pillarLength + outline, outlineColor, untextured);
+            putQuad(platformVertices, platformVertexCount, x - pillarHalfWidth, bottom,
+                    x + pillarHalfWidth, bottom + pillarLength, pillarColor, untextured);
+            putQuad(platformVertices, platformVertexCount, x - halfLength - outline, y - halfHeight - outline,
+                    x + halfLength + outline, bottom + outline, outlineColor, untextured);
+            putQuad(platformVertices, platformVertexCount, x - halfLength, y - halfHeight,
+                    x + halfLength, bottom, effectColors[platform.effect], untextured);
+        }
+
+        collectibleVertexCount = 0;
+        if (sim.mode != SinglePlayerMode) return;
+        needed = sim.collectibles.size() * 6;
+        if (collectibleVertices.getVertexCount() < needed) collectibleVertices.resize(needed);
+        for (const SimCollectible& collectible : sim.collectibles) {
+            float x = lerp(collectible.prevX, collectible.x, alpha);
+            float y = lerp(collectible.prevY, collectible.y, alpha);
+            putQuad(collectibleVertices, collectibleVertexCount, x - radius, y - radius, x + radius, y + radius,
+                    sf::Color::White, frames[collectible.type]);
+        }
+    }
+
+    // One draw call each; false when there was nothing to draw.
+    bool drawPlatforms(sf::RenderTarget& target) const {
+        if (platformVertexCount == 0) return false;
+        target.draw(&platformVertices[0], platformVertexCount, sf::Triangles);
+        return true;
+    }
+
+    bool drawCollectibles(sf::RenderTarget& target) const {
+        if (collectibleVertexCount == 0) return false;
+        sf::RenderStates states(&atlas);
+        target.draw(&collectibleVertices[0], collectibleVertexCount, sf::Triangles, states);
+        return true;
+    }
+
+    const sf::Texture& texture() const { return atlas; }
+
+private:
+    static constexpr int QUADS_PER_PLATFORM = 4;
+
+    static void putQuad(sf::VertexArray& vertices, size_t& count, float left, float top, float right, float bottom,
+                        sf::Color color, const sf::FloatRect& uv) {
+        sf::Vertex* quad = &vertices[count];
+        float uvRight = uv.left + uv.width, uvBottom = uv.top + uv.height;
+        quad[0] = sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(uv.left, uv.top));
+        quad[1] = sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(uvRight, uv.top));
+        quad[2] = sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(uvRight, uvBottom));
+        quad[3] = quad[0];
+        quad[4] = quad[2];
+        quad[5] = sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(uv.left, uvBottom));
+        count += 6;
+    }
+
+    sf::Texture atlas;
+    sf::FloatRect frames[COLLECTIBLE_TYPES];
+    float radius = 15.f;
+    sf::Color effectColors[3];
+    sf::VertexArray platformVertices;
+    sf::VertexArray collectibleVertices;
+    size_t platformVertexCount = 0;
+    size_t collectibleVertexCount = 0;
+};